@@ -0,0 +1,142 @@
+#include "cholesky.h"
+#include "../errors/errors.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// LDL^T pivots below this fraction of the largest diagonal entry count as zero
+#define LDLT_PIVOT_TOLERANCE 1e-12
+
+// Rows of L are contiguous in row-major storage, so every inner product here runs over two rows
+static double cholesky_row_dot(const double *a, const double *b, const int n) {
+    double sum = 0;
+    for (int k = 0; k < n; k++) {
+        sum += a[k] * b[k];
+    }
+    return sum;
+}
+
+int cholesky_factor(double *A, const int n, const int lda) {
+    for (int j = 0; j < n; j++) {
+        double *row_j = A + (size_t)j * lda;
+        const double d = row_j[j] - cholesky_row_dot(row_j, row_j, j);
+        if (!(d > 0)) {
+            return 0;
+        }
+        const double l_jj = sqrt(d);
+        row_j[j] = l_jj;
+
+        for (int i = j + 1; i < n; i++) {
+            double *row_i = A + (size_t)i * lda;
+            row_i[j] = (row_i[j] - cholesky_row_dot(row_i, row_j, j)) / l_jj;
+        }
+    }
+    return 1;
+}
+
+void cholesky_solve(const double *L, const int n, const int lda, double *b) {
+    for (int i = 0; i < n; i++) {
+        const double *row = L + (size_t)i * lda;
+        b[i] = (b[i] - cholesky_row_dot(row, b, i)) / row[i];
+    }
+    // L^T x = y column by column, subtracting each solved x_i along row i of L
+    for (int i = n - 1; i >= 0; i--) {
+        const double *row = L + (size_t)i * lda;
+        b[i] /= row[i];
+        const double x_i = b[i];
+        for (int k = 0; k < i; k++) {
+            b[k] -= row[k] * x_i;
+        }
+    }
+}
+
+int ldlt_factor(double *A, const int n, const int lda) {
+    double scale = 0;
+    for (int j = 0; j < n; j++) {
+        const double a_jj = fabs(A[(size_t)j * lda + j]);
+        if (a_jj > scale) scale = a_jj;
+    }
+    double *ld = malloc(sizeof(double) * (n > 0 ? n : 1));
+    if (!ld) {
+        ALLOCATION_ERROR();
+        return 0;
+    }
+
+    int ok = 1;
+    for (int j = 0; ok && j < n; j++) {
+        double *row_j = A + (size_t)j * lda;
+        // ld = L[j, k] * D[k] for k < j
+        double d = row_j[j];
+        for (int k = 0; k < j; k++) {
+            ld[k] = row_j[k] * A[(size_t)k * lda + k];
+            d -= row_j[k] * ld[k];
+        }
+        if (!(fabs(d) > LDLT_PIVOT_TOLERANCE * scale)) {
+            ok = 0;
+            break;
+        }
+        row_j[j] = d;
+
+        for (int i = j + 1; i < n; i++) {
+            double *row_i = A + (size_t)i * lda;
+            row_i[j] = (row_i[j] - cholesky_row_dot(row_i, ld, j)) / d;
+        }
+    }
+    free(ld);
+    return ok;
+}
+
+void ldlt_solve(const double *LD, const int n, const int lda, double *b) {
+    for (int i = 0; i < n; i++) {
+        b[i] -= cholesky_row_dot(LD + (size_t)i * lda, b, i);
+    }
+    for (int i = 0; i < n; i++) {
+        b[i] /= LD[(size_t)i * lda + i];
+    }
+    for (int i = n - 1; i >= 0; i--) {
+        const double *row = LD + (size_t)i * lda;
+        const double x_i = b[i];
+        for (int k = 0; k < i; k++) {
+            b[k] -= row[k] * x_i;
+        }
+    }
+}
+
+// Rebuilds the lower triangle from the untouched upper one and puts the saved diagonal back
+static void cholesky_restore(double *A, const int n, const int lda, const double *diag) {
+    for (int i = 0; i < n; i++) {
+        double *row = A + (size_t)i * lda;
+        for (int k = 0; k < i; k++) {
+            row[k] = A[(size_t)k * lda + i];
+        }
+        row[i] = diag[i];
+    }
+}
+
+int cholesky_solve_symmetric(double *A, const int n, const int lda, double *b) {
+    double *diag = malloc(sizeof(double) * (n > 0 ? n : 1));
+    if (!diag) {
+        ALLOCATION_ERROR();
+        return 0;
+    }
+    for (int i = 0; i < n; i++) {
+        diag[i] = A[(size_t)i * lda + i];
+    }
+    cholesky_restore(A, n, lda, diag);
+
+    int ok = 1;
+    if (cholesky_factor(A, n, lda)) {
+        cholesky_solve(A, n, lda, b);
+    } else {
+        cholesky_restore(A, n, lda, diag);
+        if (ldlt_factor(A, n, lda)) {
+            ldlt_solve(A, n, lda, b);
+        } else {
+            cholesky_restore(A, n, lda, diag);
+            ok = 0;
+        }
+    }
+    free(diag);
+    return ok;
+}
@@ -0,0 +1,22 @@
+#ifndef CHOLESKY_H
+#define CHOLESKY_H
+
+// Dense factorisations of symmetric n x n row-major matrices (leading dimension lda). They read and overwrite only
+// the lower triangle and the diagonal, the strict upper triangle is left as it was
+
+// A = L L^T. Returns 0 if A is not positive definite
+int cholesky_factor(double *A, int n, int lda);
+// Solves L L^T x = b in place of b, L from cholesky_factor
+void cholesky_solve(const double *L, int n, int lda, double *b);
+
+// A = L D L^T with unit lower L (below the diagonal) and D on the diagonal, no pivoting. Returns 0 on a pivot that
+// is zero relative to the largest diagonal entry
+int ldlt_factor(double *A, int n, int lda);
+// Solves L D L^T x = b in place of b, factors from ldlt_factor
+void ldlt_solve(const double *LD, int n, int lda, double *b);
+
+// Solves the symmetric system A x = b in place of b: Cholesky first, LDL^T when A is not positive definite.
+// The upper triangle of A must hold the matrix. Returns 0 if both fail, A is then restored to its input
+int cholesky_solve_symmetric(double *A, int n, int lda, double *b);
+
+#endif
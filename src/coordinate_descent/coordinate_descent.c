@@ -0,0 +1,113 @@
+#include "coordinate_descent.h"
+#include "../errors/errors.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+static double coordinate_descent_soft_threshold(const double z, const double gamma) {
+    if (z > gamma) return z - gamma;
+    if (z < -gamma) return z + gamma;
+    return 0.0;
+}
+
+// One pass over the eligible coordinates (only the nonzero ones when active_only is set). Returns the largest
+// Q_jj * delta^2 of the pass
+static double coordinate_descent_sweep(const double *Q, const int p, const int ldq, const double *c, const double l1, const double l2, const unsigned char *eligible, const int active_only, double *w, double *Qw) {
+    double max_change = 0;
+    for (int j = 0; j < p; j++) {
+        if (!eligible[j] || (active_only && w[j] == 0.0)) {
+            continue;
+        }
+        const double *q_j = Q + (size_t)j * ldq;
+        const double q_jj = q_j[j];
+        if (!(q_jj + l2 > 0)) {
+            continue;
+        }
+
+        const double w_j = coordinate_descent_soft_threshold(c[j] - Qw[j] + q_jj * w[j], l1) / (q_jj + l2);
+        const double delta = w_j - w[j];
+        if (delta == 0.0) {
+            continue;
+        }
+        w[j] = w_j;
+        for (int k = 0; k < p; k++) {
+            Qw[k] += delta * q_j[k];
+        }
+        max_change = fmax(max_change, q_jj * delta * delta);
+    }
+    return max_change;
+}
+
+int coordinate_descent_solve(const double *Q, const int p, const int ldq, const double *c, const double lambda, const double ratio, const double lambda_prev, const double tol, const int max_sweeps, double *w, double *Qw) {
+    if (!Q || !c || !w || !Qw) {
+        NULL_ERROR("Coordinate descent operand");
+        return 0;
+    }
+    if (p < 1 || max_sweeps < 1) {
+        CUSTOM_ERROR("'p' and 'max_sweeps' must be at least 1");
+        return 0;
+    }
+    if (lambda < 0 || isnan(lambda) || ratio < 0 || ratio > 1 || isnan(ratio)) {
+        CUSTOM_ERROR("'lambda' must be non-negative and 'ratio' between 0 and 1");
+        return 0;
+    }
+
+    unsigned char *eligible = malloc(p);
+    if (!eligible) {
+        ALLOCATION_ERROR();
+        return 0;
+    }
+    const double l1 = lambda * ratio;
+    const double l2 = lambda * (1.0 - ratio);
+
+    // Sequential strong rule: at lambda_prev the correlation |c_j - (Q w)_j| of a zero coefficient was at most
+    // ratio * lambda_prev, it is unlikely to reach ratio * lambda unless it was within ratio * (lambda_prev - lambda)
+    const double threshold = ratio > 0 && lambda_prev > lambda ? ratio * (2.0 * lambda - lambda_prev) : -INFINITY;
+    for (int j = 0; j < p; j++) {
+        eligible[j] = w[j] != 0.0 || fabs(c[j] - Qw[j]) >= threshold;
+    }
+
+    int sweeps = 0;
+    while (sweeps < max_sweeps) {
+        const double change = coordinate_descent_sweep(Q, p, ldq, c, l1, l2, eligible, 0, w, Qw);
+        sweeps++;
+        if (change <= tol) {
+            // Converged on the eligible set, screened coordinates must satisfy |c_j - (Q w)_j| <= l1 at w_j = 0
+            int violated = 0;
+            for (int j = 0; j < p; j++) {
+                if (!eligible[j] && fabs(c[j] - Qw[j]) > l1) {
+                    eligible[j] = 1;
+                    violated = 1;
+                }
+            }
+            if (!violated) {
+                break;
+            }
+            continue;
+        }
+        while (sweeps < max_sweeps) {
+            sweeps++;
+            if (coordinate_descent_sweep(Q, p, ldq, c, l1, l2, eligible, 1, w, Qw) <= tol) {
+                break;
+            }
+        }
+    }
+
+    free(eligible);
+    return sweeps;
+}
+
+double coordinate_descent_lambda_max(const double *c, const int p, const double ratio) {
+    if (!c) {
+        NULL_ERROR("Vector");
+        return NAN;
+    }
+    if (!(ratio > 0)) {
+        return INFINITY;
+    }
+    double max_c = 0;
+    for (int j = 0; j < p; j++) {
+        max_c = fmax(max_c, fabs(c[j]));
+    }
+    return max_c / ratio;
+}
@@ -0,0 +1,16 @@
+#ifndef COORDINATE_DESCENT_H
+#define COORDINATE_DESCENT_H
+
+// Minimises 0.5 w^T Q w - c^T w + lambda * (ratio * |w|_1 + (1 - ratio) / 2 * |w|^2) by cyclic coordinate descent
+// with soft-thresholding. Q is symmetric p x p with both triangles filled (leading dimension ldq). w holds the warm
+// start and receives the result, Qw must hold Q w and is kept up to date as coefficients move (covariance updates).
+// Sweeps repeat over the nonzero coefficients until none moves by more than tol (measured as Q_jj * delta^2), then
+// once over all of them to pick up new ones. With lambda_prev > lambda, the previous point of a descending path
+// whose solution w is, the sequential strong rule screens coordinates out first; those violating the optimality
+// conditions at the end are brought back. Returns the number of sweeps run, at most max_sweeps
+int coordinate_descent_solve(const double *Q, int p, int ldq, const double *c, double lambda, double ratio, double lambda_prev, double tol, int max_sweeps, double *w, double *Qw);
+
+// Smallest lambda whose solution is w = 0: max |c_j| / ratio, INFINITY without an L1 part
+double coordinate_descent_lambda_max(const double *c, int p, double ratio);
+
+#endif
@@ -0,0 +1,1155 @@
+#include "csv.h"
+#include "../file_mapping/file_mapping.h"
+#include "../thread_pool/thread_pool.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define csv_fseek _fseeki64
+#define csv_ftell _ftelli64
+#else
+#define csv_fseek fseeko
+#define csv_ftell ftello
+#endif
+
+#define CSV_MAX_FAST_DIGITS 19
+#define CSV_MAX_EXACT_MANTISSA (1ULL << 53)
+#define CSV_MAX_EXACT_POW10 22
+// Raw bytes read per refill of a stream's line buffer (grows only for longer lines)
+#define CSV_STREAM_BUFFER_BYTES (1 << 20)
+// Files are split into chunks of at least this many bytes when parsed on the thread pool
+#define CSV_PARALLEL_CHUNK_BYTES (1 << 20)
+
+static const double csv_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static double csv_parse_double_slow(const char *begin, const char *end, const char **stop) {
+    char small[128];
+    const size_t len = (size_t)(end - begin);
+    char *buf = len < sizeof(small) ? small : malloc(len + 1);
+    if (!buf) {
+        ALLOCATION_ERROR();
+        *stop = begin;
+        return 0;
+    }
+    memcpy(buf, begin, len);
+    buf[len] = '\0';
+
+    char *endptr;
+    errno = 0;
+    const double val = strtod(buf, &endptr);
+    // strtod flags subnormal results with ERANGE as well, those are exact enough to keep. Only overflow and
+    // underflow to zero fail
+    const int out_of_range = errno == ERANGE && (val == 0 || isinf(val));
+    const int failed = (errno != 0 && errno != ERANGE) || out_of_range || endptr == buf;
+    *stop = failed ? begin : begin + (endptr - buf);
+
+    if (buf != small) {
+        free(buf);
+    }
+    return failed ? 0 : val;
+}
+
+double csv_parse_double(const char *begin, const char *end, const char **stop) {
+    const char *p = begin;
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    int seen_digit = 0;
+
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        seen_digit = 1;
+        if (mantissa || *p != '0') {
+            if (++digits > CSV_MAX_FAST_DIGITS) return csv_parse_double_slow(begin, end, stop);
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++) {
+            seen_digit = 1;
+            if (mantissa || *p != '0') {
+                if (++digits > CSV_MAX_FAST_DIGITS) return csv_parse_double_slow(begin, end, stop);
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            }
+            exponent--;
+        }
+    }
+    if (!seen_digit) {
+        return csv_parse_double_slow(begin, end, stop);
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        int exp_negative = 0;
+        if (q < end && (*q == '-' || *q == '+')) {
+            exp_negative = *q == '-';
+            q++;
+        }
+        if (q >= end || *q < '0' || *q > '9') {
+            return csv_parse_double_slow(begin, end, stop);
+        }
+        int exp_value = 0;
+        for (; q < end && *q >= '0' && *q <= '9'; q++) {
+            if (exp_value < 10000) exp_value = exp_value * 10 + (*q - '0');
+        }
+        exponent += exp_negative ? -exp_value : exp_value;
+        p = q;
+    }
+
+    // Trailing text other than a line ending is left to strtod (hex floats, "1.5abc", ...)
+    if (p < end && *p != '\r' && *p != '\n') {
+        return csv_parse_double_slow(begin, end, stop);
+    }
+
+    double val;
+    if (mantissa == 0) {
+        val = 0.0;
+    } else if (mantissa <= CSV_MAX_EXACT_MANTISSA && exponent >= -CSV_MAX_EXACT_POW10 && exponent <= CSV_MAX_EXACT_POW10) {
+        // Both operands are exact doubles, so one correctly rounded operation gives the correctly rounded result
+        val = exponent < 0 ? (double)mantissa / csv_pow10[-exponent] : (double)mantissa * csv_pow10[exponent];
+    } else {
+        return csv_parse_double_slow(begin, end, stop);
+    }
+
+    *stop = p;
+    return negative ? -val : val;
+}
+
+// Grisu2 (Loitsch, "Printing floating-point numbers quickly and accurately with integers"): the digits of the
+// shortest decimal in the rounding interval of the value, computed with 64-bit integer arithmetic only. The result
+// always parses back to the same double and is the shortest such string in almost every case
+typedef struct {
+    uint64_t f;
+    int e;
+} CsvDiyFp;
+
+// Normalised 64-bit mantissas and binary exponents of 10^k for k = -348, -340, ..., 340
+static const uint64_t csv_cached_pow_f[] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+    0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+    0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+    0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+    0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+    0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+    0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+    0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+    0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+    0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+    0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+    0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+    0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+    0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+    0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+    0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+    0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+    0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+    0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+    0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+    0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+    0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+};
+
+static const int16_t csv_cached_pow_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+    -901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+    -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+    -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+    56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+    694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+    1013, 1039, 1066,
+};
+
+static const uint32_t csv_pow10_u32[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+static CsvDiyFp csv_diy_multiply(const CsvDiyFp a, const CsvDiyFp b) {
+    const uint64_t m32 = 0xFFFFFFFFu;
+    const uint64_t ah = a.f >> 32, al = a.f & m32, bh = b.f >> 32, bl = b.f & m32;
+    const uint64_t hh = ah * bh, lh = al * bh, hl = ah * bl, ll = al * bl;
+    // Rounded high 64 bits of the 128-bit product
+    const uint64_t mid = (ll >> 32) + (hl & m32) + (lh & m32) + (1u << 31);
+    return (CsvDiyFp){hh + (hl >> 32) + (lh >> 32) + (mid >> 32), a.e + b.e + 64};
+}
+
+static CsvDiyFp csv_diy_normalize(CsvDiyFp v) {
+    while (!(v.f & (1ULL << 63))) {
+        v.f <<= 1;
+        v.e--;
+    }
+    return v;
+}
+
+static int csv_count_digits(const uint32_t n) {
+    int digits = 1;
+    while (digits < 10 && n >= csv_pow10_u32[digits]) {
+        digits++;
+    }
+    return digits;
+}
+
+static void csv_grisu_round(char *digits, const int len, const uint64_t delta, uint64_t rest, const uint64_t ten_kappa, const uint64_t wp_w) {
+    while (rest < wp_w && delta - rest >= ten_kappa && (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+        digits[len - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+// Writes the digits of a positive finite value and returns their count, *k is set so that value ~ digits * 10^k
+static int csv_grisu2(const double value, char *digits, int *k) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint64_t hidden = 1ULL << 52;
+    const int biased_e = (int)((bits >> 52) & 0x7FF);
+    CsvDiyFp v = {bits & (hidden - 1), -1074};
+    if (biased_e) {
+        v.f += hidden;
+        v.e = biased_e - 1075;
+    }
+
+    // Boundaries halfway to the neighbouring doubles, the lower one is closer when v is a power of two
+    CsvDiyFp plus = csv_diy_normalize((CsvDiyFp){(v.f << 1) + 1, v.e - 1});
+    CsvDiyFp minus = v.f == hidden && biased_e > 1 ? (CsvDiyFp){(v.f << 2) - 1, v.e - 2} : (CsvDiyFp){(v.f << 1) - 1, v.e - 1};
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+
+    // Cached power c = 10^-K scaling plus into the exponent range [-60, -32]
+    const double dk = (-61 - plus.e) * 0.30102999566398114 + 347;
+    int ik = (int)dk;
+    if (dk - ik > 0.0) ik++;
+    const int index = (ik >> 3) + 1;
+    *k = -(-348 + index * 8);
+    const CsvDiyFp c = {csv_cached_pow_f[index], csv_cached_pow_e[index]};
+
+    const CsvDiyFp w = csv_diy_multiply(csv_diy_normalize(v), c);
+    CsvDiyFp wp = csv_diy_multiply(plus, c);
+    CsvDiyFp wm = csv_diy_multiply(minus, c);
+    wm.f++;
+    wp.f--;
+
+    // Digit generation: integral part of wp first, then fractional digits until inside the interval
+    uint64_t delta = wp.f - wm.f;
+    const uint64_t wp_w = wp.f - w.f;
+    const int shift = -wp.e;
+    const uint64_t one = 1ULL << shift;
+    uint32_t p1 = (uint32_t)(wp.f >> shift);
+    uint64_t p2 = wp.f & (one - 1);
+    int kappa = csv_count_digits(p1);
+    int len = 0;
+    while (kappa > 0) {
+        const uint32_t d = p1 / csv_pow10_u32[kappa - 1];
+        p1 %= csv_pow10_u32[kappa - 1];
+        if (d || len) digits[len++] = (char)('0' + d);
+        kappa--;
+        const uint64_t rest = ((uint64_t)p1 << shift) + p2;
+        if (rest <= delta) {
+            *k += kappa;
+            csv_grisu_round(digits, len, delta, rest, (uint64_t)csv_pow10_u32[kappa] << shift, wp_w);
+            return len;
+        }
+    }
+    uint64_t scale = 1;
+    while (1) {
+        p2 *= 10;
+        delta *= 10;
+        scale *= 10;
+        const char d = (char)(p2 >> shift);
+        if (d || len) digits[len++] = (char)('0' + d);
+        p2 &= one - 1;
+        kappa--;
+        if (p2 < delta) {
+            *k += kappa;
+            csv_grisu_round(digits, len, delta, p2, one, wp_w * scale);
+            return len;
+        }
+    }
+}
+
+int csv_format_double(const double value, char *out) {
+    char *p = out;
+    if (isnan(value)) {
+        memcpy(p, "nan", 4);
+        return 3;
+    }
+    if (signbit(value)) {
+        *p++ = '-';
+    }
+    if (isinf(value)) {
+        memcpy(p, "inf", 4);
+        return (int)(p - out) + 3;
+    }
+    if (value == 0) {
+        memcpy(p, "0", 2);
+        return (int)(p - out) + 1;
+    }
+
+    char digits[20];
+    int k;
+    const int len = csv_grisu2(fabs(value), digits, &k);
+    // Position of the decimal point relative to the digits: value = 0.digits * 10^point
+    const int point = len + k;
+    if (k >= 0 && point <= 21) {
+        memcpy(p, digits, len);
+        memset(p + len, '0', k);
+        p += point;
+    } else if (point > 0 && point <= 21) {
+        memcpy(p, digits, point);
+        p[point] = '.';
+        memcpy(p + point + 1, digits + point, len - point);
+        p += len + 1;
+    } else if (point > -6 && point <= 0) {
+        *p++ = '0';
+        *p++ = '.';
+        memset(p, '0', -point);
+        memcpy(p - point, digits, len);
+        p += len - point;
+    } else {
+        *p++ = digits[0];
+        if (len > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, len - 1);
+            p += len - 1;
+        }
+        int exponent = point - 1;
+        *p++ = 'e';
+        *p++ = exponent < 0 ? '-' : '+';
+        if (exponent < 0) exponent = -exponent;
+        if (exponent >= 100) *p++ = (char)('0' + exponent / 100);
+        if (exponent >= 10) *p++ = (char)('0' + exponent / 10 % 10);
+        *p++ = (char)('0' + exponent % 10);
+    }
+    *p = '\0';
+    return (int)(p - out);
+}
+
+static const char *csv_next_line(const char *p, const char *end) {
+    const char *nl = memchr(p, '\n', (size_t)(end - p));
+    return nl ? nl + 1 : end;
+}
+
+typedef struct {
+    int row;
+    int col;
+} CsvInvalid;
+
+// Invalid fields found by a worker, reported once all chunks are parsed so the warnings come out in row order
+typedef struct {
+    CsvInvalid *items;
+    int count;
+    int capacity;
+} CsvInvalidList;
+
+static void csv_report_invalid(CsvInvalidList *invalid, const int row, const int col) {
+    if (!invalid) {
+        CUSTOM_WARNING("Invalid element at [%d,%d], set to 0", row, col);
+        return;
+    }
+    if (invalid->count == invalid->capacity) {
+        const int capacity = invalid->capacity ? invalid->capacity * 2 : 16;
+        CsvInvalid *tmp = realloc(invalid->items, sizeof(CsvInvalid) * capacity);
+        if (!tmp) {
+            CUSTOM_WARNING("Invalid element at [%d,%d], set to 0", row, col);
+            return;
+        }
+        invalid->items = tmp;
+        invalid->capacity = capacity;
+    }
+    invalid->items[invalid->count++] = (CsvInvalid){row, col};
+}
+
+// Which fields of a line are converted and where they go. File column j is stored at row[slots[j]], or skipped
+// without being parsed when slots[j] is -1, and column target (-1 for none) is also stored in the target array.
+// NULL slots keeps every column in order. row_base is the file row of the first line, for the warnings
+typedef struct {
+    const int *slots;
+    int out_cols;
+    int target;
+    int row_base;
+} CsvProjection;
+
+// Fields are maximal runs of non-separator bytes, so empty fields are skipped like strtok would
+static void csv_parse_line(const char *p, const char *line_end, const char separator, const CsvProjection *proj, double *row, double *target, const int cols, const int row_index, CsvInvalidList *invalid) {
+    int j = 0;
+    while (j < cols) {
+        while (p < line_end && *p == separator) p++;
+        if (p >= line_end) break;
+
+        const char *field_end = memchr(p, separator, (size_t)(line_end - p));
+        if (!field_end) field_end = line_end;
+
+        const int slot = proj->slots ? proj->slots[j] : j;
+        const int is_target = target && j == proj->target;
+        if (slot >= 0 || is_target) {
+            const char *stop;
+            double val = csv_parse_double(p, field_end, &stop);
+            if (stop == p) {
+                csv_report_invalid(invalid, row_index, j);
+                val = 0;
+            }
+            if (slot >= 0) row[slot] = val;
+            if (is_target) *target = val;
+        }
+        j++;
+        p = field_end;
+    }
+}
+
+static Matrix *csv_wrap(double *data, const size_t rows, const int cols) {
+    Matrix *X = malloc(sizeof(Matrix));
+    if (!X) {
+        ALLOCATION_ERROR();
+        free(data);
+        return NULL;
+    }
+    X->rows = (int)rows;
+    X->cols = cols;
+    X->data = data;
+    X->mapping = NULL;
+    return X;
+}
+
+// Rows parsed from a range of the file: proj->out_cols values each in X and, when proj->target is set, one in y
+typedef struct {
+    double *X;
+    double *y;
+    size_t rows;
+} CsvParsed;
+
+static int csv_read_serial(const char *p, const char *end, const char separator, const int cols, const CsvProjection *proj, CsvParsed *out) {
+    const int out_cols = proj->out_cols;
+    const int has_target = proj->target >= 0;
+
+    // Capacity starts from the first line's length and doubles when exceeded
+    const char *first_end = csv_next_line(p, end);
+    size_t capacity = (size_t)(end - p) / (size_t)(first_end - p) + 1;
+    double *data = malloc(sizeof(double) * capacity * out_cols);
+    double *y = has_target ? malloc(sizeof(double) * capacity) : NULL;
+    if (!data || (has_target && !y)) {
+        ALLOCATION_ERROR();
+        free(data);
+        free(y);
+        return 0;
+    }
+
+    size_t rows = 0;
+    while (p < end) {
+        if (rows == capacity) {
+            if (capacity >= INT_MAX) {
+                CUSTOM_ERROR("CSV file has more than %d rows", INT_MAX);
+                free(data);
+                free(y);
+                return 0;
+            }
+            capacity = capacity * 2 > INT_MAX ? INT_MAX : capacity * 2;
+            double *tmp = realloc(data, sizeof(double) * capacity * out_cols);
+            if (tmp) {
+                data = tmp;
+                if (has_target) {
+                    tmp = realloc(y, sizeof(double) * capacity);
+                    if (tmp) y = tmp;
+                }
+            }
+            if (!tmp) {
+                ALLOCATION_ERROR();
+                free(data);
+                free(y);
+                return 0;
+            }
+        }
+
+        const char *line_end = csv_next_line(p, end);
+        double *row = data + rows * out_cols;
+        double *target = has_target ? y + rows : NULL;
+        memset(row, 0, sizeof(double) * out_cols);
+        if (target) *target = 0;
+        csv_parse_line(p, line_end, separator, proj, row, target, cols, proj->row_base + (int)rows, NULL);
+        rows++;
+        p = line_end;
+    }
+
+    if (rows < capacity) {
+        double *tmp = realloc(data, sizeof(double) * rows * out_cols);
+        if (tmp) data = tmp;
+        if (has_target) {
+            tmp = realloc(y, sizeof(double) * rows);
+            if (tmp) y = tmp;
+        }
+    }
+    out->X = data;
+    out->y = y;
+    out->rows = rows;
+    return 1;
+}
+
+typedef struct {
+    const char *begin;
+    const char *end;
+    size_t first_row;
+    size_t rows;
+    CsvInvalidList invalid;
+} CsvChunk;
+
+typedef struct {
+    CsvChunk *chunks;
+    const char *file_end;
+    char separator;
+    int cols;
+    const CsvProjection *proj;
+    double *data;
+    double *y;
+} CsvParallelTask;
+
+static void csv_count_chunk(void *ctx, const int task, const int thread) {
+    const CsvParallelTask *t = ctx;
+    CsvChunk *chunk = &t->chunks[task];
+    size_t rows = 0;
+    const char *p = chunk->begin;
+    while (p < chunk->end) {
+        const char *nl = memchr(p, '\n', (size_t)(chunk->end - p));
+        if (!nl) {
+            rows++;
+            break;
+        }
+        rows++;
+        p = nl + 1;
+    }
+    chunk->rows = rows;
+}
+
+static void csv_parse_chunk(void *ctx, const int task, const int thread) {
+    const CsvParallelTask *t = ctx;
+    CsvChunk *chunk = &t->chunks[task];
+    const char *p = chunk->begin;
+    for (size_t i = 0; i < chunk->rows; i++) {
+        const char *line_end = csv_next_line(p, t->file_end);
+        const size_t row = chunk->first_row + i;
+        double *target = t->y ? t->y + row : NULL;
+        csv_parse_line(p, line_end, t->separator, t->proj, t->data + row * t->proj->out_cols, target, t->cols, t->proj->row_base + (int)row, &chunk->invalid);
+        p = line_end;
+    }
+}
+
+// Chunks start at line boundaries. Lines are counted per chunk first, so every chunk then parses straight into
+// its own block of rows of the final matrix and no stitching copy is needed
+static int csv_read_parallel(const char *p, const char *end, const char separator, const int cols, const CsvProjection *proj, CsvParsed *out) {
+    ThreadPool *pool = clearn_thread_pool();
+    const size_t len = (size_t)(end - p);
+    size_t num_chunks = len / CSV_PARALLEL_CHUNK_BYTES;
+    if (num_chunks > (size_t)(8 * clearn_get_num_threads())) {
+        num_chunks = (size_t)(8 * clearn_get_num_threads());
+    }
+
+    CsvChunk *chunks = calloc(num_chunks, sizeof(CsvChunk));
+    if (!chunks) {
+        ALLOCATION_ERROR();
+        return 0;
+    }
+    const char *begin = p;
+    for (size_t k = 0; k < num_chunks; k++) {
+        chunks[k].begin = begin;
+        begin = k + 1 == num_chunks ? end : csv_next_line(p + len / num_chunks * (k + 1), end);
+        if (begin < chunks[k].begin) begin = chunks[k].begin;
+        chunks[k].end = begin;
+    }
+
+    CsvParallelTask task = {chunks, end, separator, cols, proj, NULL, NULL};
+    thread_pool_run(pool, (int)num_chunks, csv_count_chunk, &task);
+
+    size_t rows = 0;
+    for (size_t k = 0; k < num_chunks; k++) {
+        chunks[k].first_row = rows;
+        rows += chunks[k].rows;
+    }
+    if (rows > INT_MAX) {
+        CUSTOM_ERROR("CSV file has more than %d rows", INT_MAX);
+        free(chunks);
+        return 0;
+    }
+
+    task.data = calloc(rows * proj->out_cols, sizeof(double));
+    task.y = proj->target >= 0 ? calloc(rows, sizeof(double)) : NULL;
+    if (!task.data || (proj->target >= 0 && !task.y)) {
+        ALLOCATION_ERROR();
+        free(task.data);
+        free(task.y);
+        free(chunks);
+        return 0;
+    }
+    thread_pool_run(pool, (int)num_chunks, csv_parse_chunk, &task);
+
+    for (size_t k = 0; k < num_chunks; k++) {
+        for (int i = 0; i < chunks[k].invalid.count; i++) {
+            CUSTOM_WARNING("Invalid element at [%d,%d], set to 0", chunks[k].invalid.items[i].row, chunks[k].invalid.items[i].col);
+        }
+        free(chunks[k].invalid.items);
+    }
+    free(chunks);
+
+    out->X = task.data;
+    out->y = task.y;
+    out->rows = rows;
+    return 1;
+}
+
+static int csv_read_range(const char *p, const char *end, const char separator, const int cols, const CsvProjection *proj, CsvParsed *out) {
+    if (clearn_thread_pool() && (size_t)(end - p) >= 2 * CSV_PARALLEL_CHUNK_BYTES) {
+        return csv_read_parallel(p, end, separator, cols, proj, out);
+    }
+    return csv_read_serial(p, end, separator, cols, proj, out);
+}
+
+// Maps the file and finds the header line (NULL without one) and the first data line, past an optional UTF-8 BOM
+static FileMapping *csv_open(const char *path, const int has_header, const char **header, const char **p, const char **end) {
+    FileMapping *mapping = file_mapping_open(path);
+    if (!mapping) {
+        CUSTOM_ERROR("File %s not found", path);
+        return NULL;
+    }
+
+    *p = mapping->data;
+    *end = *p + mapping->size;
+    if (mapping->size >= 3 && (unsigned char)(*p)[0] == 0xEF && (unsigned char)(*p)[1] == 0xBB && (unsigned char)(*p)[2] == 0xBF) {
+        *p += 3;
+    }
+    *header = NULL;
+    if (has_header == 1 && *p < *end) {
+        *header = *p;
+        *p = csv_next_line(*p, *end);
+    }
+    return mapping;
+}
+
+static int csv_count_cols(const char *p, const char *end, const char separator) {
+    int cols = 1;
+    for (const char *c = p; c < end && *c != '\0' && *c != '\n' && *c != '\r'; c++) {
+        if (*c == separator) {
+            cols++;
+        }
+    }
+    return cols;
+}
+
+// Splits the line at p on every separator, keeping empty fields. The pointer array and the strings share one allocation
+static char **csv_split_line(const char *p, const char *end, const char separator, int *count) {
+    const char *line_end = p;
+    while (line_end < end && *line_end != '\0' && *line_end != '\n' && *line_end != '\r') {
+        line_end++;
+    }
+
+    const int n = csv_count_cols(p, line_end, separator);
+    const size_t text = (size_t)(line_end - p) + 1;
+    char **names = malloc(sizeof(char *) * n + text);
+    if (!names) {
+        ALLOCATION_ERROR();
+        return NULL;
+    }
+
+    char *dst = (char *)(names + n);
+    memcpy(dst, p, text - 1);
+    dst[text - 1] = '\0';
+    names[0] = dst;
+    for (int j = 1; j < n; dst++) {
+        if (*dst == separator) {
+            *dst = '\0';
+            names[j++] = dst + 1;
+        }
+    }
+    *count = n;
+    return names;
+}
+
+Matrix *csv_read(const char *path, const char separator, const int has_header) {
+    if (has_header < 0 || has_header > 1) {
+        CUSTOM_ERROR("Property 'has_header' must be 0 or 1");
+        return NULL;
+    }
+    const char *header, *p, *end;
+    FileMapping *mapping = csv_open(path, has_header, &header, &p, &end);
+    if (!mapping) {
+        return NULL;
+    }
+    if (p >= end) {
+        CUSTOM_ERROR("Empty CSV file");
+        file_mapping_close(mapping);
+        return NULL;
+    }
+
+    const int cols = csv_count_cols(p, end, separator);
+    const CsvProjection proj = {NULL, cols, -1, 0};
+    CsvParsed parsed;
+    const int ok = csv_read_range(p, end, separator, cols, &proj, &parsed);
+    file_mapping_close(mapping);
+    return ok ? csv_wrap(parsed.X, parsed.rows, cols) : NULL;
+}
+
+char **csv_read_column_names(const char *path, const char separator, int *count) {
+    if (!count) {
+        NULL_ERROR("Count");
+        return NULL;
+    }
+    *count = 0;
+    const char *header, *p, *end;
+    FileMapping *mapping = csv_open(path, 1, &header, &p, &end);
+    if (!mapping) {
+        return NULL;
+    }
+    char **names = csv_split_line(header ? header : p, end, separator, count);
+    file_mapping_close(mapping);
+    return names;
+}
+
+CsvReadOptions csv_read_options_default(void) {
+    const CsvReadOptions options = {NULL, NULL, 0, CSV_LAST_COLUMN, NULL, 0, 0};
+    return options;
+}
+
+static int csv_find_column(char *const *names, const int count, const char *name) {
+    for (int j = 0; j < count; j++) {
+        if (strcmp(names[j], name) == 0) {
+            return j;
+        }
+    }
+    CUSTOM_ERROR("Column '%s' not found in the header", name);
+    return -1;
+}
+
+// Fills slots (one per file column) from the options and returns the number of feature columns, 0 on error
+static int csv_select_columns(const CsvReadOptions *options, char *const *names, const int num_names, const int cols, const int target, int *slots) {
+    for (int j = 0; j < cols; j++) {
+        slots[j] = -1;
+    }
+
+    int out_cols = 0;
+    if (options->num_columns == 0) {
+        for (int j = 0; j < cols; j++) {
+            if (j != target) {
+                slots[j] = out_cols++;
+            }
+        }
+    }
+    for (int k = 0; k < options->num_columns; k++) {
+        const int j = options->column_names ? csv_find_column(names, num_names, options->column_names[k]) : options->columns[k];
+        if (j < 0) {
+            return 0;
+        }
+        if (j >= cols) {
+            CUSTOM_ERROR("Column %d is out of range for %d columns", j, cols);
+            return 0;
+        }
+        if (slots[j] >= 0) {
+            CUSTOM_ERROR("Column %d is selected more than once", j);
+            return 0;
+        }
+        slots[j] = out_cols++;
+    }
+
+    if (out_cols == 0) {
+        CUSTOM_ERROR("No feature columns selected");
+    }
+    return out_cols;
+}
+
+static int csv_resolve_target(const CsvReadOptions *options, char *const *names, const int num_names, const int cols) {
+    if (options->target_name) {
+        const int target = csv_find_column(names, num_names, options->target_name);
+        if (target >= cols) {
+            CUSTOM_ERROR("Target column '%s' has no values in the data rows", options->target_name);
+            return -1;
+        }
+        return target;
+    }
+    const int target = options->target == CSV_LAST_COLUMN ? cols - 1 : options->target;
+    if (target < 0 || target >= cols) {
+        CUSTOM_ERROR("Target column %d is out of range for %d columns", target, cols);
+        return -1;
+    }
+    return target;
+}
+
+void read_csv_xy(const char *path, const char separator, const int has_header, const CsvReadOptions *options, Matrix **X, Vector **y) {
+    if (!X) {
+        NULL_ERROR("Output matrix");
+        return;
+    }
+    *X = NULL;
+    if (y) {
+        *y = NULL;
+    }
+    if (has_header < 0 || has_header > 1) {
+        CUSTOM_ERROR("Property 'has_header' must be 0 or 1");
+        return;
+    }
+
+    const CsvReadOptions opts = options ? *options : csv_read_options_default();
+    if (opts.num_columns < 0 || opts.row_start < 0 || opts.num_rows < 0) {
+        CUSTOM_ERROR("'num_columns', 'row_start' and 'num_rows' must be non-negative");
+        return;
+    }
+    if (opts.num_columns > 0 && !opts.columns && !opts.column_names) {
+        NULL_ERROR("Column selection");
+        return;
+    }
+    const int by_name = (opts.num_columns > 0 && opts.column_names) || (y && opts.target_name);
+    if (by_name && has_header != 1) {
+        CUSTOM_ERROR("Selecting columns by name requires 'has_header' to be 1");
+        return;
+    }
+
+    const char *header, *p, *end;
+    FileMapping *mapping = csv_open(path, has_header, &header, &p, &end);
+    if (!mapping) {
+        return;
+    }
+    if (p >= end) {
+        CUSTOM_ERROR("Empty CSV file");
+        file_mapping_close(mapping);
+        return;
+    }
+    const int cols = csv_count_cols(p, end, separator);
+
+    int num_names = 0;
+    char **names = by_name ? csv_split_line(header, end, separator, &num_names) : NULL;
+    int *slots = malloc(sizeof(int) * cols);
+    if ((by_name && !names) || !slots) {
+        if (!slots) ALLOCATION_ERROR();
+        free(names);
+        free(slots);
+        file_mapping_close(mapping);
+        return;
+    }
+
+    const int target = y ? csv_resolve_target(&opts, names, num_names, cols) : -1;
+    const int out_cols = !y || target >= 0 ? csv_select_columns(&opts, names, num_names, cols, target, slots) : 0;
+    free(names);
+
+    // Lines before the range are only scanned for their newline
+    for (int i = 0; i < opts.row_start && p < end; i++) {
+        p = csv_next_line(p, end);
+    }
+    if (opts.num_rows > 0) {
+        const char *range_end = p;
+        for (int i = 0; i < opts.num_rows && range_end < end; i++) {
+            range_end = csv_next_line(range_end, end);
+        }
+        end = range_end;
+    }
+    if (out_cols > 0 && p >= end) {
+        CUSTOM_ERROR("Row range starts past the end of the file");
+    }
+
+    CsvParsed parsed;
+    const CsvProjection proj = {slots, out_cols, target, opts.row_start};
+    const int ok = out_cols > 0 && p < end && csv_read_range(p, end, separator, cols, &proj, &parsed);
+    free(slots);
+    file_mapping_close(mapping);
+    if (!ok) {
+        return;
+    }
+
+    Vector *target_vector = NULL;
+    if (y) {
+        target_vector = malloc(sizeof(Vector));
+        if (!target_vector) {
+            ALLOCATION_ERROR();
+            free(parsed.X);
+            free(parsed.y);
+            return;
+        }
+        target_vector->dim = (int)parsed.rows;
+        target_vector->data = parsed.y;
+    }
+    *X = csv_wrap(parsed.X, parsed.rows, out_cols);
+    if (!*X) {
+        free(target_vector);
+        free(parsed.y);
+        return;
+    }
+    if (y) {
+        *y = target_vector;
+    }
+}
+
+// Next line of the stream's buffered input, refilling from the file as needed. The returned range stays valid
+// until the following call
+static int csv_stream_line(CsvStream *stream, const char **line, const char **line_end) {
+    while (1) {
+        const char *start = stream->buf + stream->buf_start;
+        const size_t avail = stream->buf_len - stream->buf_start;
+        const char *nl = avail ? memchr(start, '\n', avail) : NULL;
+        if (nl) {
+            *line = start;
+            *line_end = nl + 1;
+            stream->buf_start += (size_t)(nl + 1 - start);
+            return 1;
+        }
+        if (stream->file_eof) {
+            if (avail == 0) return 0;
+            *line = start;
+            *line_end = start + avail;
+            stream->buf_start = stream->buf_len;
+            return 1;
+        }
+
+        memmove(stream->buf, start, avail);
+        stream->buf_start = 0;
+        stream->buf_len = avail;
+        if (stream->buf_len == stream->buf_cap) {
+            char *tmp = realloc(stream->buf, stream->buf_cap * 2);
+            if (!tmp) {
+                ALLOCATION_ERROR();
+                stream->file_eof = 1;
+                continue;
+            }
+            stream->buf = tmp;
+            stream->buf_cap *= 2;
+        }
+        const size_t n = fread(stream->buf + stream->buf_len, 1, stream->buf_cap - stream->buf_len, stream->file);
+        stream->buf_len += n;
+        if (n == 0) {
+            stream->file_eof = 1;
+        }
+    }
+}
+
+static int csv_stream_fill(CsvStream *stream, CsvStreamBlock *block) {
+    const CsvProjection stream_proj = {NULL, stream->cols, -1, 0};
+    int rows = 0;
+    const char *line;
+    const char *line_end;
+    while (rows < CSV_STREAM_BLOCK_ROWS && csv_stream_line(stream, &line, &line_end)) {
+        double *row = block->data + (size_t)rows * stream->cols;
+        memset(row, 0, sizeof(double) * stream->cols);
+        csv_parse_line(line, line_end, stream->separator, &stream_proj, row, NULL, stream->cols, stream->next_row++, NULL);
+        rows++;
+    }
+    return rows;
+}
+
+// Producer: fills blocks 0, 1, 0, ... as the consumer releases them. A block with 0 rows marks the end of the file
+static void *csv_stream_worker(void *arg) {
+    CsvStream *stream = arg;
+    int index = 0;
+
+    pthread_mutex_lock(&stream->lock);
+    while (!stream->stop) {
+        CsvStreamBlock *block = &stream->blocks[index];
+        while (!stream->stop && block->ready) {
+            pthread_cond_wait(&stream->changed, &stream->lock);
+        }
+        if (stream->stop) break;
+        pthread_mutex_unlock(&stream->lock);
+
+        const int rows = csv_stream_fill(stream, block);
+
+        pthread_mutex_lock(&stream->lock);
+        block->rows = rows;
+        block->ready = 1;
+        pthread_cond_broadcast(&stream->changed);
+        if (rows == 0) break;
+        index ^= 1;
+    }
+    pthread_mutex_unlock(&stream->lock);
+    return NULL;
+}
+
+static int csv_stream_start(CsvStream *stream) {
+    if (csv_fseek(stream->file, stream->data_offset, SEEK_SET) != 0) {
+        CUSTOM_ERROR("Could not seek in CSV stream");
+        return 0;
+    }
+    stream->buf_start = 0;
+    stream->buf_len = 0;
+    stream->file_eof = 0;
+    stream->next_row = 0;
+    stream->blocks[0].ready = 0;
+    stream->blocks[1].ready = 0;
+    stream->current = 0;
+    stream->offset = 0;
+    stream->finished = 0;
+    stream->stop = 0;
+
+    if (pthread_create(&stream->thread, NULL, csv_stream_worker, stream) != 0) {
+        CUSTOM_ERROR("Could not start the CSV prefetch thread");
+        return 0;
+    }
+    stream->running = 1;
+    return 1;
+}
+
+static void csv_stream_stop(CsvStream *stream) {
+    if (!stream->running) {
+        return;
+    }
+    pthread_mutex_lock(&stream->lock);
+    stream->stop = 1;
+    pthread_cond_broadcast(&stream->changed);
+    pthread_mutex_unlock(&stream->lock);
+    pthread_join(stream->thread, NULL);
+    stream->running = 0;
+}
+
+CsvStream *csv_stream_open(const char *path, const char separator, const int has_header) {
+    if (!path) {
+        NULL_ERROR("Path");
+        return NULL;
+    }
+    if (has_header < 0 || has_header > 1) {
+        CUSTOM_ERROR("Property 'has_header' must be 0 or 1");
+        return NULL;
+    }
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        CUSTOM_ERROR("File %s not found", path);
+        return NULL;
+    }
+
+    CsvStream *stream = calloc(1, sizeof(CsvStream));
+    if (!stream) {
+        ALLOCATION_ERROR();
+        fclose(file);
+        return NULL;
+    }
+    stream->file = file;
+    stream->separator = separator;
+    stream->buf_cap = CSV_STREAM_BUFFER_BYTES;
+    stream->buf = malloc(stream->buf_cap);
+    if (!stream->buf) {
+        ALLOCATION_ERROR();
+        fclose(file);
+        free(stream);
+        return NULL;
+    }
+    pthread_mutex_init(&stream->lock, NULL);
+    pthread_cond_init(&stream->changed, NULL);
+
+    unsigned char bom[3];
+    if (fread(bom, 1, 3, file) != 3 || bom[0] != 0xEF || bom[1] != 0xBB || bom[2] != 0xBF) {
+        csv_fseek(file, 0, SEEK_SET);
+    }
+
+    const char *line;
+    const char *line_end;
+    if (has_header == 1) {
+        csv_stream_line(stream, &line, &line_end);
+    }
+    stream->data_offset = csv_ftell(file) - (long long)(stream->buf_len - stream->buf_start);
+
+    if (!csv_stream_line(stream, &line, &line_end)) {
+        CUSTOM_ERROR("Empty CSV file");
+        csv_stream_close(stream);
+        return NULL;
+    }
+    stream->cols = 1;
+    for (const char *c = line; c < line_end && *c != '\0' && *c != '\n' && *c != '\r'; c++) {
+        if (*c == separator) {
+            stream->cols++;
+        }
+    }
+
+    for (int b = 0; b < 2; b++) {
+        stream->blocks[b].data = malloc(sizeof(double) * CSV_STREAM_BLOCK_ROWS * stream->cols);
+        if (!stream->blocks[b].data) {
+            ALLOCATION_ERROR();
+            csv_stream_close(stream);
+            return NULL;
+        }
+    }
+    if (!csv_stream_start(stream)) {
+        csv_stream_close(stream);
+        return NULL;
+    }
+    return stream;
+}
+
+void csv_stream_close(CsvStream *stream) {
+    if (!stream) {
+        NULL_ERROR("CsvStream");
+        return;
+    }
+
+    csv_stream_stop(stream);
+    pthread_mutex_destroy(&stream->lock);
+    pthread_cond_destroy(&stream->changed);
+    free(stream->blocks[0].data);
+    free(stream->blocks[1].data);
+    free(stream->buf);
+    fclose(stream->file);
+    free(stream);
+}
+
+int csv_stream_next_batch(CsvStream *stream, Matrix *out, const int max_rows) {
+    if (!stream) {
+        NULL_ERROR("CsvStream");
+        return 0;
+    }
+    if (!out) {
+        NULL_ERROR("Matrix");
+        return 0;
+    }
+    if (out->cols != stream->cols || max_rows < 1 || out->rows < max_rows) {
+        CUSTOM_ERROR("Batch matrix must have %d columns and at least max_rows rows", stream->cols);
+        return 0;
+    }
+    if (!stream->running) {
+        return 0;
+    }
+
+    int copied = 0;
+    pthread_mutex_lock(&stream->lock);
+    while (copied < max_rows && !stream->finished) {
+        CsvStreamBlock *block = &stream->blocks[stream->current];
+        while (!block->ready) {
+            pthread_cond_wait(&stream->changed, &stream->lock);
+        }
+        if (block->rows == 0) {
+            stream->finished = 1;
+            break;
+        }
+        pthread_mutex_unlock(&stream->lock);
+
+        // A ready block belongs to the consumer until it is released below
+        const int n = block->rows - stream->offset < max_rows - copied ? block->rows - stream->offset : max_rows - copied;
+        memcpy(out->data + (size_t)copied * out->cols, block->data + (size_t)stream->offset * stream->cols, sizeof(double) * n * stream->cols);
+        copied += n;
+        stream->offset += n;
+
+        pthread_mutex_lock(&stream->lock);
+        if (stream->offset == block->rows) {
+            block->ready = 0;
+            stream->offset = 0;
+            stream->current ^= 1;
+            pthread_cond_broadcast(&stream->changed);
+        }
+    }
+    pthread_mutex_unlock(&stream->lock);
+    return copied;
+}
+
+void csv_stream_rewind(CsvStream *stream) {
+    if (!stream) {
+        NULL_ERROR("CsvStream");
+        return;
+    }
+
+    csv_stream_stop(stream);
+    csv_stream_start(stream);
+}
@@ -0,0 +1,90 @@
+#ifndef CSV_H
+#define CSV_H
+
+#include <pthread.h>
+#include <stdio.h>
+
+#include "../matrix/matrix.h"
+
+// Parses the number at the start of [begin, end) with the semantics of strtod. Plain decimals take an exact
+// fast path, anything else goes through strtod. *stop is set past the parsed text, or to begin on failure
+double csv_parse_double(const char *begin, const char *end, const char **stop);
+
+// Room for any output of csv_format_double, terminator included
+#define CSV_DOUBLE_CHARS 32
+// Short decimal text that parses back to exactly value, the shortest such text in almost every case and at most a
+// digit longer otherwise (nan and inf as strtod accepts them). Writes a NUL-terminated string to out, which must
+// hold CSV_DOUBLE_CHARS bytes, and returns its length
+int csv_format_double(double value, char *out);
+
+// Single pass over the memory-mapped file, same result as read_csv. With the global thread pool enabled
+// (clearn_set_num_threads) files of a few MB and up are parsed in parallel chunks
+Matrix *csv_read(const char *path, char separator, int has_header);
+// Column selection for read_csv_xy. Feature columns are given by index (columns) or by header name (column_names),
+// num_columns entries, in the order they should appear in X. num_columns 0 selects every column except the target.
+// The target is the column index target (CSV_LAST_COLUMN for the last one) unless target_name is set. Only data
+// rows [row_start, row_start + num_rows) are read, num_rows 0 meaning up to the end of the file
+#define CSV_LAST_COLUMN (-1)
+
+typedef struct {
+    const int *columns;
+    const char *const *column_names;
+    int num_columns;
+    int target;
+    const char *target_name;
+    int row_start;
+    int num_rows;
+} CsvReadOptions;
+
+CsvReadOptions csv_read_options_default(void);
+// Reads the selected columns into X and the target column into y in one pass. Fields of unselected columns are
+// skipped without being converted. y may be NULL to read features only. On error *X and *y are NULL
+void read_csv_xy(const char *path, char separator, int has_header, const CsvReadOptions *options, Matrix **X, Vector **y);
+
+// Fields of the file's first line. The pointer array and the strings share one allocation, release it with free
+char **csv_read_column_names(const char *path, char separator, int *count);
+
+// Rows parsed ahead of the consumer by the stream's background thread, per block (two blocks in flight)
+#define CSV_STREAM_BLOCK_ROWS 4096
+
+typedef struct {
+    double *data;
+    int rows;
+    int ready;
+} CsvStreamBlock;
+
+// Reads a CSV file in row batches with bounded memory: a raw byte buffer and two parsed row blocks. A background
+// thread fills the next block while the caller consumes the current one. Rows follow the read_csv rules
+typedef struct {
+    FILE *file;
+    char separator;
+    int cols;
+    long long data_offset;
+
+    char *buf;
+    size_t buf_cap;
+    size_t buf_start;
+    size_t buf_len;
+    int file_eof;
+    int next_row;
+
+    CsvStreamBlock blocks[2];
+    int current;
+    int offset;
+    int finished;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    int running;
+    int stop;
+} CsvStream;
+
+CsvStream *csv_stream_open(const char *path, char separator, int has_header);
+void csv_stream_close(CsvStream *stream);
+// Copies up to max_rows rows into the first rows of out (out->cols must match, out->rows >= max_rows).
+// Returns the number of rows copied, 0 once the file is exhausted
+int csv_stream_next_batch(CsvStream *stream, Matrix *out, int max_rows);
+void csv_stream_rewind(CsvStream *stream);
+
+#endif
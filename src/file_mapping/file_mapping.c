@@ -0,0 +1,155 @@
+#include "file_mapping.h"
+#include "../errors/errors.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static int file_mapping_read(FileMapping *mapping, const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return 0;
+    }
+
+    size_t capacity = 1 << 16;
+    size_t size = 0;
+    char *data = malloc(capacity);
+    if (!data) {
+        ALLOCATION_ERROR();
+        fclose(file);
+        return 0;
+    }
+    size_t n;
+    while ((n = fread(data + size, 1, capacity - size, file)) > 0) {
+        size += n;
+        if (size == capacity) {
+            capacity *= 2;
+            char *tmp = realloc(data, capacity);
+            if (!tmp) {
+                ALLOCATION_ERROR();
+                free(data);
+                fclose(file);
+                return 0;
+            }
+            data = tmp;
+        }
+    }
+    fclose(file);
+
+    mapping->data = data;
+    mapping->size = size;
+    mapping->mapped = 0;
+    return 1;
+}
+
+#ifdef _WIN32
+
+static int file_mapping_map(FileMapping *mapping, const char *path) {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return 0;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return 0;
+    }
+    HANDLE view = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if (!view) {
+        CloseHandle(file);
+        return 0;
+    }
+    void *data = MapViewOfFile(view, FILE_MAP_COPY, 0, 0, 0);
+    if (!data) {
+        CloseHandle(view);
+        CloseHandle(file);
+        return 0;
+    }
+
+    mapping->data = data;
+    mapping->size = (size_t)size.QuadPart;
+    mapping->mapped = 1;
+    mapping->file = file;
+    mapping->mapping = view;
+    return 1;
+}
+
+static void file_mapping_unmap(FileMapping *mapping) {
+    UnmapViewOfFile(mapping->data);
+    CloseHandle(mapping->mapping);
+    CloseHandle(mapping->file);
+}
+
+#else
+
+static int file_mapping_map(FileMapping *mapping, const char *path) {
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return 0;
+    }
+#ifdef MADV_SEQUENTIAL
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+
+    mapping->data = data;
+    mapping->size = (size_t)st.st_size;
+    mapping->mapped = 1;
+    return 1;
+}
+
+static void file_mapping_unmap(FileMapping *mapping) {
+    munmap(mapping->data, mapping->size);
+}
+
+#endif
+
+FileMapping *file_mapping_open(const char *path) {
+    if (!path) {
+        NULL_ERROR("Path");
+        return NULL;
+    }
+
+    FileMapping *mapping = calloc(1, sizeof(FileMapping));
+    if (!mapping) {
+        ALLOCATION_ERROR();
+        return NULL;
+    }
+    // Empty files, pipes and anything else that cannot be mapped are read instead
+    if (!file_mapping_map(mapping, path) && !file_mapping_read(mapping, path)) {
+        free(mapping);
+        return NULL;
+    }
+    return mapping;
+}
+
+void file_mapping_close(FileMapping *mapping) {
+    if (!mapping) {
+        NULL_ERROR("FileMapping");
+        return;
+    }
+
+    if (mapping->mapped) {
+        file_mapping_unmap(mapping);
+    } else {
+        free(mapping->data);
+    }
+    free(mapping);
+}
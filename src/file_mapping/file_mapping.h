@@ -0,0 +1,21 @@
+#ifndef FILE_MAPPING_H
+#define FILE_MAPPING_H
+
+#include <stddef.h>
+
+// View of a whole file. Memory-mapped where the platform allows it, otherwise read into a heap buffer. Mapped
+// pages are copy-on-write: writes through data stay private to the process and never reach the file
+typedef struct {
+    char *data;
+    size_t size;
+    int mapped;
+#ifdef _WIN32
+    void *file;
+    void *mapping;
+#endif
+} FileMapping;
+
+FileMapping *file_mapping_open(const char *path);
+void file_mapping_close(FileMapping *mapping);
+
+#endif
@@ -0,0 +1,548 @@
+#include "gemm.h"
+#include "../errors/errors.h"
+#include "../thread_pool/thread_pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Register tile (MR x NR) and cache blocks: a KC x NR panel of B stays in L1,
+// an MC x KC block of A in L2 and a KC x NC block of B in L3
+#define GEMM_MR 4
+#define GEMM_NR 8
+#define GEMM_KC 256
+#define GEMM_MC 128
+#define GEMM_NC 4096
+
+// Below these many multiply-adds packing (or forking) costs more than it saves
+#define GEMM_SMALL_SIZE (48 * 48 * 48)
+#define GEMM_PARALLEL_SIZE (128 * 128 * 128)
+// Upper bound on the memory taken by the per-thread partial Grams of gemm_syrk
+#define GEMM_SYRK_PARTIAL_BYTES ((size_t)256 << 20)
+#define GEMM_SYRK_REDUCE_GRAIN 32768
+// Rows handled together by gemm_gemv and the independent accumulator lanes per row
+#define GEMM_GEMV_ROWS 4
+#define GEMM_GEMV_LANES 8
+
+// Operands are addressed through row and column strides, so a transposed
+// operand is the same memory with its strides swapped
+typedef struct {
+    const double *data;
+    size_t rs;
+    size_t cs;
+} GemmOperand;
+
+static GemmOperand gemm_operand(const double *data, const int ld, const int trans) {
+    const GemmOperand op = {data, trans ? 1 : (size_t)ld, trans ? (size_t)ld : 1};
+    return op;
+}
+
+static GemmOperand gemm_operand_offset(const GemmOperand op, const int row, const int col) {
+    const GemmOperand sub = {op.data + row * op.rs + col * op.cs, op.rs, op.cs};
+    return sub;
+}
+
+static GemmEpilogue gemm_epilogue_offset(const GemmEpilogue *epilogue, const int row, const int col) {
+    GemmEpilogue sub = *epilogue;
+    if (sub.bias) sub.bias += col;
+    if (sub.pre) sub.pre += (size_t)row * sub.ldp + col;
+    return sub;
+}
+
+static void gemm_epilogue_row(const GemmEpilogue *epilogue, double *c, double *pre, const int n) {
+    if (epilogue->bias) {
+        for (int j = 0; j < n; j++) c[j] += epilogue->bias[j];
+    }
+    if (pre) {
+        memcpy(pre, c, sizeof(double) * n);
+    }
+    if (epilogue->activation) {
+        epilogue->activation(c, c, n);
+    }
+}
+
+static void gemm_small(const int m, const int n, const int k, const GemmOperand A, const GemmOperand B, double *C, const int ldc, const GemmEpilogue *epilogue) {
+    for (int i = 0; i < m; i++) {
+        double *c = C + (size_t)i * ldc;
+        const double *a = A.data + i * A.rs;
+        if (B.cs == 1) {
+            memset(c, 0, sizeof(double) * n);
+            for (int p = 0; p < k; p++) {
+                const double a_p = a[p * A.cs];
+                const double *b = B.data + p * B.rs;
+                for (int j = 0; j < n; j++) {
+                    c[j] += a_p * b[j];
+                }
+            }
+        } else {
+            for (int j = 0; j < n; j++) {
+                const double *b = B.data + j * B.cs;
+                double sum = 0;
+                for (int p = 0; p < k; p++) {
+                    sum += a[p * A.cs] * b[p * B.rs];
+                }
+                c[j] = sum;
+            }
+        }
+        if (epilogue) {
+            gemm_epilogue_row(epilogue, c, epilogue->pre ? epilogue->pre + (size_t)i * epilogue->ldp : NULL, n);
+        }
+    }
+}
+
+static void gemm_pack_A(const int mc, const int kc, const GemmOperand A, double *packed) {
+    for (int ir = 0; ir < mc; ir += GEMM_MR) {
+        const int mr = mc - ir < GEMM_MR ? mc - ir : GEMM_MR;
+        for (int p = 0; p < kc; p++) {
+            for (int i = 0; i < mr; i++) {
+                packed[i] = A.data[(ir + i) * A.rs + p * A.cs];
+            }
+            for (int i = mr; i < GEMM_MR; i++) {
+                packed[i] = 0.0;
+            }
+            packed += GEMM_MR;
+        }
+    }
+}
+
+static void gemm_pack_B(const int kc, const int nc, const GemmOperand B, double *packed) {
+    for (int jr = 0; jr < nc; jr += GEMM_NR) {
+        const int nr = nc - jr < GEMM_NR ? nc - jr : GEMM_NR;
+        for (int p = 0; p < kc; p++) {
+            const double *b = B.data + p * B.rs + jr * B.cs;
+            for (int j = 0; j < nr; j++) {
+                packed[j] = b[j * B.cs];
+            }
+            for (int j = nr; j < GEMM_NR; j++) {
+                packed[j] = 0.0;
+            }
+            packed += GEMM_NR;
+        }
+    }
+}
+
+static void gemm_micro_kernel(const int kc, const double *a, const double *b, double *C, const int ldc, const int mr, const int nr, const int accumulate, const GemmEpilogue *epilogue) {
+    double acc[GEMM_MR][GEMM_NR] = {{0}};
+
+    for (int p = 0; p < kc; p++) {
+        for (int i = 0; i < GEMM_MR; i++) {
+            const double a_i = a[i];
+            for (int j = 0; j < GEMM_NR; j++) {
+                acc[i][j] += a_i * b[j];
+            }
+        }
+        a += GEMM_MR;
+        b += GEMM_NR;
+    }
+
+    if (accumulate) {
+        for (int i = 0; i < mr; i++) {
+            const double *c = C + (size_t)i * ldc;
+            for (int j = 0; j < nr; j++) acc[i][j] += c[j];
+        }
+    }
+
+    if (epilogue) {
+        for (int i = 0; i < mr; i++) {
+            gemm_epilogue_row(epilogue, acc[i], epilogue->pre ? epilogue->pre + (size_t)i * epilogue->ldp : NULL, nr);
+        }
+    }
+
+    for (int i = 0; i < mr; i++) {
+        double *c = C + (size_t)i * ldc;
+        for (int j = 0; j < nr; j++) c[j] = acc[i][j];
+    }
+}
+
+static void gemm_blocked(const int m, const int n, const int k, const GemmOperand A, const GemmOperand B, double *C, const int ldc, const GemmEpilogue *epilogue, double *packed_A, double *packed_B) {
+    for (int jc = 0; jc < n; jc += GEMM_NC) {
+        const int nc = n - jc < GEMM_NC ? n - jc : GEMM_NC;
+
+        for (int pc = 0; pc < k; pc += GEMM_KC) {
+            const int kc = k - pc < GEMM_KC ? k - pc : GEMM_KC;
+            gemm_pack_B(kc, nc, gemm_operand_offset(B, pc, jc), packed_B);
+
+            for (int ic = 0; ic < m; ic += GEMM_MC) {
+                const int mc = m - ic < GEMM_MC ? m - ic : GEMM_MC;
+                gemm_pack_A(mc, kc, gemm_operand_offset(A, ic, pc), packed_A);
+
+                for (int jr = 0; jr < nc; jr += GEMM_NR) {
+                    const int nr = nc - jr < GEMM_NR ? nc - jr : GEMM_NR;
+                    for (int ir = 0; ir < mc; ir += GEMM_MR) {
+                        const int mr = mc - ir < GEMM_MR ? mc - ir : GEMM_MR;
+                        // The epilogue runs once the last KC block has been accumulated
+                        GemmEpilogue tile_epilogue;
+                        if (epilogue && pc + kc == k) {
+                            tile_epilogue = gemm_epilogue_offset(epilogue, ic + ir, jc + jr);
+                        }
+                        gemm_micro_kernel(kc, packed_A + (size_t)ir * kc, packed_B + (size_t)jr * kc,
+                                          C + (size_t)(ic + ir) * ldc + jc + jr, ldc, mr, nr, pc > 0,
+                                          epilogue && pc + kc == k ? &tile_epilogue : NULL);
+                    }
+                }
+            }
+        }
+    }
+}
+
+typedef struct {
+    int m, n, k;
+    GemmOperand A;
+    GemmOperand B;
+    double *C;
+    int ldc;
+    const GemmEpilogue *epilogue;
+    int tile_rows;
+    int tile_cols;
+    int col_tiles;
+    double **packed_A;
+    double **packed_B;
+} GemmTask;
+
+static void gemm_tile(void *ctx, const int task, const int thread) {
+    const GemmTask *t = ctx;
+    const int row = task / t->col_tiles * t->tile_rows;
+    const int col = task % t->col_tiles * t->tile_cols;
+    const int rows = t->m - row < t->tile_rows ? t->m - row : t->tile_rows;
+    const int cols = t->n - col < t->tile_cols ? t->n - col : t->tile_cols;
+
+    GemmEpilogue tile_epilogue;
+    if (t->epilogue) {
+        tile_epilogue = gemm_epilogue_offset(t->epilogue, row, col);
+    }
+    gemm_blocked(rows, cols, t->k, gemm_operand_offset(t->A, row, 0), gemm_operand_offset(t->B, 0, col),
+                 t->C + (size_t)row * t->ldc + col, t->ldc, t->epilogue ? &tile_epilogue : NULL,
+                 t->packed_A[thread], t->packed_B[thread]);
+}
+
+static int gemm_parallel(const int m, const int n, const int k, const GemmOperand A, const GemmOperand B, double *C, const int ldc, const GemmEpilogue *epilogue) {
+    ThreadPool *pool = clearn_thread_pool();
+    if (!pool || (double)m * n * k < GEMM_PARALLEL_SIZE) {
+        return 0;
+    }
+    const int threads = pool->num_threads;
+
+    // Output tiles: MC rows each, columns split further until every thread has work
+    const int row_tiles = (m + GEMM_MC - 1) / GEMM_MC;
+    int col_tiles = (n + GEMM_NC - 1) / GEMM_NC;
+    if (row_tiles * col_tiles < 2 * threads) {
+        const int wanted = (2 * threads + row_tiles - 1) / row_tiles;
+        const int max_tiles = (n + GEMM_NR - 1) / GEMM_NR;
+        col_tiles = wanted < max_tiles ? wanted : max_tiles;
+    }
+    const int tile_cols = ((n + col_tiles - 1) / col_tiles + GEMM_NR - 1) / GEMM_NR * GEMM_NR;
+    col_tiles = (n + tile_cols - 1) / tile_cols;
+
+    const int kc_max = k < GEMM_KC ? k : GEMM_KC;
+    const int mc_padded = ((m < GEMM_MC ? m : GEMM_MC) + GEMM_MR - 1) / GEMM_MR * GEMM_MR;
+    const int nc_padded = ((tile_cols < GEMM_NC ? tile_cols : GEMM_NC) + GEMM_NR - 1) / GEMM_NR * GEMM_NR;
+
+    double *buffers[2 * threads];
+    for (int t = 0; t < threads; t++) {
+        buffers[t] = malloc(sizeof(double) * mc_padded * kc_max);
+        buffers[threads + t] = malloc(sizeof(double) * kc_max * nc_padded);
+    }
+    int ok = 1;
+    for (int t = 0; t < 2 * threads; t++) {
+        if (!buffers[t]) ok = 0;
+    }
+
+    if (ok) {
+        GemmTask task = {m, n, k, A, B, C, ldc, epilogue, GEMM_MC, tile_cols, col_tiles, buffers, buffers + threads};
+        thread_pool_run(pool, row_tiles * col_tiles, gemm_tile, &task);
+    }
+
+    for (int t = 0; t < 2 * threads; t++) {
+        free(buffers[t]);
+    }
+    return ok;
+}
+
+static void gemm_run(const int m, const int n, const int k, const GemmOperand A, const GemmOperand B, double *C, const int ldc, const GemmEpilogue *epilogue) {
+    if ((double)m * n * k < GEMM_SMALL_SIZE) {
+        gemm_small(m, n, k, A, B, C, ldc, epilogue);
+        return;
+    }
+    if (gemm_parallel(m, n, k, A, B, C, ldc, epilogue)) {
+        return;
+    }
+
+    const int kc_max = k < GEMM_KC ? k : GEMM_KC;
+    const int mc_max = m < GEMM_MC ? m : GEMM_MC;
+    const int nc_max = n < GEMM_NC ? n : GEMM_NC;
+    const int mc_padded = (mc_max + GEMM_MR - 1) / GEMM_MR * GEMM_MR;
+    const int nc_padded = (nc_max + GEMM_NR - 1) / GEMM_NR * GEMM_NR;
+
+    double *packed_A = malloc(sizeof(double) * mc_padded * kc_max);
+    double *packed_B = malloc(sizeof(double) * kc_max * nc_padded);
+    if (!packed_A || !packed_B) {
+        ALLOCATION_ERROR();
+        free(packed_A);
+        free(packed_B);
+        gemm_small(m, n, k, A, B, C, ldc, epilogue);
+        return;
+    }
+
+    gemm_blocked(m, n, k, A, B, C, ldc, epilogue, packed_A, packed_B);
+
+    free(packed_A);
+    free(packed_B);
+}
+
+// Column sums and B^T y of a packed KC x NC block, read while it is still in cache
+static void gemm_syrk_sums(const int kc, const int nc, const double *packed_B, const double *y, const size_t y_stride, double *sums, double *Bty) {
+    for (int jr = 0; jr < nc; jr += GEMM_NR) {
+        const int nr = nc - jr < GEMM_NR ? nc - jr : GEMM_NR;
+        const double *b = packed_B + (size_t)jr * kc;
+        double s[GEMM_NR] = {0};
+        double t[GEMM_NR] = {0};
+        for (int p = 0; p < kc; p++) {
+            const double y_p = Bty ? y[p * y_stride] : 0.0;
+            for (int j = 0; j < GEMM_NR; j++) {
+                s[j] += b[j];
+                t[j] += y_p * b[j];
+            }
+            b += GEMM_NR;
+        }
+        for (int j = 0; j < nr; j++) {
+            if (sums) sums[jr + j] += s[j];
+            if (Bty) Bty[jr + j] += t[j];
+        }
+    }
+}
+
+// Upper triangle of C += B^T B, register tiles entirely below the diagonal are skipped. The transposed operand
+// is the same memory with its strides swapped
+static void gemm_syrk_blocked(const int n, const int k, const GemmOperand B, const double *y, const size_t y_stride, double *C, const int ldc, double *sums, double *Bty, double *packed_A, double *packed_B) {
+    const GemmOperand A = {B.data, B.cs, B.rs};
+
+    for (int jc = 0; jc < n; jc += GEMM_NC) {
+        const int nc = n - jc < GEMM_NC ? n - jc : GEMM_NC;
+
+        for (int pc = 0; pc < k; pc += GEMM_KC) {
+            const int kc = k - pc < GEMM_KC ? k - pc : GEMM_KC;
+            gemm_pack_B(kc, nc, gemm_operand_offset(B, pc, jc), packed_B);
+            if (sums || Bty) {
+                gemm_syrk_sums(kc, nc, packed_B, Bty ? y + pc * y_stride : NULL, y_stride, sums ? sums + jc : NULL, Bty ? Bty + jc : NULL);
+            }
+
+            for (int ic = 0; ic < jc + nc; ic += GEMM_MC) {
+                const int mc = jc + nc - ic < GEMM_MC ? jc + nc - ic : GEMM_MC;
+                gemm_pack_A(mc, kc, gemm_operand_offset(A, ic, pc), packed_A);
+
+                for (int jr = 0; jr < nc; jr += GEMM_NR) {
+                    const int nr = nc - jr < GEMM_NR ? nc - jr : GEMM_NR;
+                    for (int ir = 0; ir < mc && ic + ir < jc + jr + nr; ir += GEMM_MR) {
+                        const int mr = mc - ir < GEMM_MR ? mc - ir : GEMM_MR;
+                        gemm_micro_kernel(kc, packed_A + (size_t)ir * kc, packed_B + (size_t)jr * kc,
+                                          C + (size_t)(ic + ir) * ldc + jc + jr, ldc, mr, nr, 1, NULL);
+                    }
+                }
+            }
+        }
+    }
+}
+
+typedef struct {
+    int n, k;
+    int chunk;
+    GemmOperand B;
+    const double *y;
+    size_t y_stride;
+    double *C;
+    int ldc;
+    double *sums;
+    double *Bty;
+    double **partials;
+    double **packed_A;
+    double **packed_B;
+} GemmSyrkTask;
+
+// Task 0 accumulates straight into the outputs, every other task into its own zeroed Gram (n x n) followed by
+// its sums and B^T y
+static void gemm_syrk_task(void *ctx, const int task, const int thread) {
+    const GemmSyrkTask *t = ctx;
+    const int start = task * t->chunk;
+    const int rows = t->k - start < t->chunk ? t->k - start : t->chunk;
+    const GemmOperand B = gemm_operand_offset(t->B, start, 0);
+    const double *y = t->Bty ? t->y + start * t->y_stride : NULL;
+
+    if (task == 0) {
+        gemm_syrk_blocked(t->n, rows, B, y, t->y_stride, t->C, t->ldc, t->sums, t->Bty, t->packed_A[thread], t->packed_B[thread]);
+        return;
+    }
+    double *C = t->partials[task];
+    double *sums = C + (size_t)t->n * t->n;
+    gemm_syrk_blocked(t->n, rows, B, y, t->y_stride, C, t->n, t->sums ? sums : NULL, t->Bty ? sums + t->n : NULL,
+                      t->packed_A[thread], t->packed_B[thread]);
+}
+
+typedef struct {
+    const GemmSyrkTask *syrk;
+    int num_partials;
+} GemmSyrkReduce;
+
+static void gemm_syrk_reduce_range(void *ctx, const int start, const int end) {
+    const GemmSyrkReduce *r = ctx;
+    const int n = r->syrk->n;
+    for (int i = start; i < end; i++) {
+        double *c = r->syrk->C + (size_t)i * r->syrk->ldc;
+        for (int t = 1; t < r->num_partials; t++) {
+            const double *p = r->syrk->partials[t] + (size_t)i * n;
+            for (int j = i; j < n; j++) c[j] += p[j];
+        }
+    }
+}
+
+// y (m) = A x. The lanes keep the reductions vectorisable without reassociating floating point, only the final
+// horizontal sum of each row is sequential
+static void gemm_gemv_n(const int m, const int n, const double *A, const int lda, const double *x, double *y) {
+    const int n_main = n - n % GEMM_GEMV_LANES;
+    int i = 0;
+    for (; i + GEMM_GEMV_ROWS <= m; i += GEMM_GEMV_ROWS) {
+        double acc[GEMM_GEMV_ROWS][GEMM_GEMV_LANES] = {{0}};
+        const double *a = A + (size_t)i * lda;
+        for (int j = 0; j < n_main; j += GEMM_GEMV_LANES) {
+            for (int r = 0; r < GEMM_GEMV_ROWS; r++) {
+                const double *a_r = a + (size_t)r * lda + j;
+                for (int l = 0; l < GEMM_GEMV_LANES; l++) {
+                    acc[r][l] += a_r[l] * x[j + l];
+                }
+            }
+        }
+        for (int r = 0; r < GEMM_GEMV_ROWS; r++) {
+            const double *a_r = a + (size_t)r * lda;
+            double sum = 0;
+            for (int l = 0; l < GEMM_GEMV_LANES; l++) sum += acc[r][l];
+            for (int j = n_main; j < n; j++) sum += a_r[j] * x[j];
+            y[i + r] = sum;
+        }
+    }
+    for (; i < m; i++) {
+        const double *a = A + (size_t)i * lda;
+        double acc[GEMM_GEMV_LANES] = {0};
+        for (int j = 0; j < n_main; j += GEMM_GEMV_LANES) {
+            for (int l = 0; l < GEMM_GEMV_LANES; l++) acc[l] += a[j + l] * x[j + l];
+        }
+        double sum = 0;
+        for (int l = 0; l < GEMM_GEMV_LANES; l++) sum += acc[l];
+        for (int j = n_main; j < n; j++) sum += a[j] * x[j];
+        y[i] = sum;
+    }
+}
+
+// y (n) = A^T x, a row-wise axpy: each pass over y folds in four rows so y is loaded and stored a quarter as often
+static void gemm_gemv_t(const int m, const int n, const double *A, const int lda, const double *x, double *y) {
+    memset(y, 0, sizeof(double) * n);
+    int i = 0;
+    for (; i + GEMM_GEMV_ROWS <= m; i += GEMM_GEMV_ROWS) {
+        const double *a0 = A + (size_t)i * lda;
+        const double *a1 = a0 + lda;
+        const double *a2 = a1 + lda;
+        const double *a3 = a2 + lda;
+        const double x0 = x[i], x1 = x[i + 1], x2 = x[i + 2], x3 = x[i + 3];
+        for (int j = 0; j < n; j++) {
+            y[j] += x0 * a0[j] + x1 * a1[j] + x2 * a2[j] + x3 * a3[j];
+        }
+    }
+    for (; i < m; i++) {
+        const double *a = A + (size_t)i * lda;
+        const double x_i = x[i];
+        for (int j = 0; j < n; j++) y[j] += x_i * a[j];
+    }
+}
+
+void gemm_multiply(const int trans_A, const int trans_B, const int m, const int n, const int k, const double *A, const int lda, const double *B, const int ldb, double *C, const int ldc) {
+    gemm_multiply_fused(trans_A, trans_B, m, n, k, A, lda, B, ldb, C, ldc, NULL);
+}
+
+void gemm_multiply_fused(const int trans_A, const int trans_B, const int m, const int n, const int k, const double *A_data, const int lda, const double *B_data, const int ldb, double *C, const int ldc, const GemmEpilogue *epilogue) {
+    gemm_run(m, n, k, gemm_operand(A_data, lda, trans_A), gemm_operand(B_data, ldb, trans_B), C, ldc, epilogue);
+}
+
+void gemm_multiply_strided(const int m, const int n, const int k, const double *A_data, const size_t rs_A, const size_t cs_A, const double *B_data, const size_t rs_B, const size_t cs_B, double *C, const int ldc, const GemmEpilogue *epilogue) {
+    const GemmOperand A = {A_data, rs_A, cs_A};
+    const GemmOperand B = {B_data, rs_B, cs_B};
+    gemm_run(m, n, k, A, B, C, ldc, epilogue);
+}
+
+void gemm_gemv(const int trans_A, const int m, const int n, const double *A, const int lda, const double *x, double *y) {
+    if (!A || !x || !y) {
+        NULL_ERROR("GEMV operand");
+        return;
+    }
+    if (m < 0 || n < 0 || lda < n) {
+        CUSTOM_ERROR("GEMV dimensions must be non-negative with lda >= n");
+        return;
+    }
+    if (trans_A) {
+        gemm_gemv_t(m, n, A, lda, x, y);
+    } else {
+        gemm_gemv_n(m, n, A, lda, x, y);
+    }
+}
+
+void gemm_syrk(const int n, const int k, const double *A_data, const size_t rs_A, const size_t cs_A, const double *y, const size_t y_stride, double *C, const int ldc, double *sums, double *Aty) {
+    if (!A_data || !C || (Aty && !y)) {
+        NULL_ERROR("Operand");
+        return;
+    }
+    if (n < 1 || k < 1) {
+        return;
+    }
+
+    // One row block per task, as many tasks as threads while every partial Gram still has work worth its memory
+    ThreadPool *pool = clearn_thread_pool();
+    const size_t partial_size = (size_t)n * n + 2 * (size_t)n;
+    int tasks = pool && (double)n * n * k >= 2.0 * GEMM_PARALLEL_SIZE ? pool->num_threads : 1;
+    if (tasks > (k + GEMM_KC - 1) / GEMM_KC) {
+        tasks = (k + GEMM_KC - 1) / GEMM_KC;
+    }
+    if ((size_t)(tasks - 1) * partial_size * sizeof(double) > GEMM_SYRK_PARTIAL_BYTES) {
+        tasks = 1 + (int)(GEMM_SYRK_PARTIAL_BYTES / (partial_size * sizeof(double)));
+    }
+    const int chunk = ((k + tasks - 1) / tasks + GEMM_KC - 1) / GEMM_KC * GEMM_KC;
+    tasks = (k + chunk - 1) / chunk;
+    const int threads = tasks > 1 ? pool->num_threads : 1;
+
+    const int kc_max = k < GEMM_KC ? k : GEMM_KC;
+    const int mc_padded = ((n < GEMM_MC ? n : GEMM_MC) + GEMM_MR - 1) / GEMM_MR * GEMM_MR;
+    const int nc_padded = ((n < GEMM_NC ? n : GEMM_NC) + GEMM_NR - 1) / GEMM_NR * GEMM_NR;
+
+    double *buffers[2 * threads + tasks];
+    int ok = 1;
+    for (int t = 0; t < threads; t++) {
+        buffers[t] = malloc(sizeof(double) * mc_padded * kc_max);
+        buffers[threads + t] = malloc(sizeof(double) * kc_max * nc_padded);
+    }
+    buffers[2 * threads] = NULL;
+    for (int t = 1; t < tasks; t++) {
+        buffers[2 * threads + t] = calloc(partial_size, sizeof(double));
+    }
+    for (int t = 0; t < 2 * threads + tasks; t++) {
+        if (!buffers[t] && t != 2 * threads) ok = 0;
+    }
+
+    if (ok) {
+        const GemmOperand B = {A_data, rs_A, cs_A};
+        GemmSyrkTask task = {n, k, chunk, B, y, y_stride, C, ldc, sums, Aty, buffers + 2 * threads, buffers, buffers + threads};
+        thread_pool_run(pool, tasks, gemm_syrk_task, &task);
+
+        if (tasks > 1) {
+            GemmSyrkReduce reduce = {&task, tasks};
+            clearn_parallel_for(n, 1 + GEMM_SYRK_REDUCE_GRAIN / n, gemm_syrk_reduce_range, &reduce);
+            for (int t = 1; t < tasks; t++) {
+                const double *partial_sums = task.partials[t] + (size_t)n * n;
+                for (int j = 0; j < n; j++) {
+                    if (sums) sums[j] += partial_sums[j];
+                    if (Aty) Aty[j] += partial_sums[n + j];
+                }
+            }
+        }
+    } else {
+        ALLOCATION_ERROR();
+    }
+
+    for (int t = 0; t < 2 * threads + tasks; t++) {
+        free(buffers[t]);
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef GEMM_H
+#define GEMM_H
+
+#include <stddef.h>
+
+// C (m x n) = op(A) (m x k) * op(B) (k x n), all row-major with leading dimensions lda, ldb, ldc,
+// where op(X) reads X as transposed when trans_X is 1
+void gemm_multiply(int trans_A, int trans_B, int m, int n, int k, const double *A, int lda, const double *B, int ldb, double *C, int ldc);
+
+// Applied to each output tile while it is still in registers: C = activation(op(A) * op(B) + bias).
+// bias (one value per column), activation (an array kernel such as math_relu_array, applied in place) and pre
+// (receives the values before the activation) may be NULL
+typedef struct {
+    const double *bias;
+    void (*activation)(const double *in, double *out, size_t n);
+    double *pre;
+    int ldp;
+} GemmEpilogue;
+
+void gemm_multiply_fused(int trans_A, int trans_B, int m, int n, int k, const double *A, int lda, const double *B, int ldb, double *C, int ldc, const GemmEpilogue *epilogue);
+
+// Operands with arbitrary strides: element (i, p) of A is A[i * rs_A + p * cs_A], likewise for B. epilogue may be NULL
+void gemm_multiply_strided(int m, int n, int k, const double *A, size_t rs_A, size_t cs_A, const double *B, size_t rs_B, size_t cs_B, double *C, int ldc, const GemmEpilogue *epilogue);
+
+// y = op(A) x for the row-major m x n A with leading dimension lda: y has m values, or n when trans_A is 1 and
+// A^T is applied. Rows are taken four at a time against register accumulators, meant for the minibatch shapes of
+// the iterative trainers where a GEMM would be mostly packing. The additions are ordered differently from a plain
+// loop (eight partial sums per dot product, four rows per pass for A^T), so results can differ from one in the
+// last bits
+void gemm_gemv(int trans_A, int m, int n, const double *A, int lda, const double *x, double *y);
+
+// Symmetric rank-k update: the upper triangle of C (n x n) += A^T A for the k x n operand A (element (p, j) at
+// A[p * rs_A + j * cs_A]), entries below the diagonal are left unspecified. sums (n) += the column sums of A and
+// Aty (n) += A^T y while each block of rows is still in cache; either may be NULL, y is read only for Aty.
+// Rows are split across the global thread pool, each thread accumulating its own partial Gram
+void gemm_syrk(int n, int k, const double *A, size_t rs_A, size_t cs_A, const double *y, size_t y_stride, double *C, int ldc, double *sums, double *Aty);
+
+#endif
@@ -0,0 +1,170 @@
+#include "lbfgs.h"
+#include "../errors/errors.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Weak Wolfe constants (sufficient decrease, curvature) and the trial points allowed per line search
+#define LBFGS_C1 1e-4
+#define LBFGS_C2 0.9
+#define LBFGS_MAX_LINE_SEARCH 40
+
+LbfgsOptions lbfgs_options_default(void) {
+    const LbfgsOptions options = {LBFGS_DEFAULT_HISTORY, 100, 1e-6, 0};
+    return options;
+}
+
+static double lbfgs_dot(const double *a, const double *b, const int n) {
+    double sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+static double lbfgs_norm_inf(const double *a, const int n) {
+    double norm = 0;
+    for (int i = 0; i < n; i++) {
+        norm = fmax(norm, fabs(a[i]));
+    }
+    return norm;
+}
+
+int lbfgs_minimize(const LbfgsObjective f, void *ctx, const int n, double *x, const LbfgsOptions *options) {
+    if (!f || !x) {
+        NULL_ERROR("Objective or starting point");
+        return -1;
+    }
+    const LbfgsOptions opt = options ? *options : lbfgs_options_default();
+    if (n < 1 || opt.history < 1 || opt.max_iters < 1) {
+        CUSTOM_ERROR("'n', 'history' and 'max_iters' must be at least 1");
+        return -1;
+    }
+    if (opt.tol < 0 || isnan(opt.tol) || opt.print_every < 0) {
+        CUSTOM_ERROR("'tol' and 'print_every' must be non-negative");
+        return -1;
+    }
+
+    // Correction pairs live in a ring of m slots, head is the next one to overwrite
+    const int m = opt.history;
+    double *buf = malloc(sizeof(double) * (2 * (size_t)m * n + 4 * (size_t)n + 2 * (size_t)m));
+    if (!buf) {
+        ALLOCATION_ERROR();
+        return -1;
+    }
+    double *S = buf;
+    double *Y = S + (size_t)m * n;
+    double *g = Y + (size_t)m * n;
+    double *d = g + n;
+    double *x_new = d + n;
+    double *g_new = x_new + n;
+    double *rho = g_new + n;
+    double *alpha = rho + m;
+
+    double fx = f(ctx, x, g);
+    if (!isfinite(fx)) {
+        CUSTOM_ERROR("Loss is not finite at the starting point");
+        free(buf);
+        return -1;
+    }
+
+    int count = 0;
+    int head = 0;
+    int iter;
+    for (iter = 0; iter < opt.max_iters; iter++) {
+        if (opt.print_every > 0 && iter % opt.print_every == 0) {
+            printf("Iteration: %d | Cost (LOSS): [%lf]\n", iter + 1, fx);
+        }
+        if (lbfgs_norm_inf(g, n) <= opt.tol) {
+            break;
+        }
+
+        // Two-loop recursion: d = -H g with H the inverse Hessian estimate, scaled by the newest pair
+        for (int i = 0; i < n; i++) {
+            d[i] = -g[i];
+        }
+        for (int k = 0; k < count; k++) {
+            const int j = (head - 1 - k + m) % m;
+            alpha[j] = rho[j] * lbfgs_dot(S + (size_t)j * n, d, n);
+            const double *y_j = Y + (size_t)j * n;
+            for (int i = 0; i < n; i++) d[i] -= alpha[j] * y_j[i];
+        }
+        if (count > 0) {
+            const int j = (head - 1 + m) % m;
+            const double *y_j = Y + (size_t)j * n;
+            const double gamma = 1.0 / (rho[j] * lbfgs_dot(y_j, y_j, n));
+            for (int i = 0; i < n; i++) d[i] *= gamma;
+        }
+        for (int k = count - 1; k >= 0; k--) {
+            const int j = (head - 1 - k + m) % m;
+            const double beta = rho[j] * lbfgs_dot(Y + (size_t)j * n, d, n);
+            const double *s_j = S + (size_t)j * n;
+            for (int i = 0; i < n; i++) d[i] += (alpha[j] - beta) * s_j[i];
+        }
+
+        double dg = lbfgs_dot(g, d, n);
+        if (!(dg < 0)) {
+            // Not a descent direction: forget the history and restart from steepest descent
+            count = 0;
+            for (int i = 0; i < n; i++) d[i] = -g[i];
+            dg = -lbfgs_dot(g, g, n);
+        }
+
+        // Without history the first trial moves a unit distance along -g
+        double t = count == 0 ? fmin(1.0, 1.0 / sqrt(-dg)) : 1.0;
+        double lo = 0;
+        double hi = INFINITY;
+        double f_new = fx;
+        int found = 0;
+        for (int trial = 0; trial < LBFGS_MAX_LINE_SEARCH; trial++) {
+            for (int i = 0; i < n; i++) x_new[i] = x[i] + t * d[i];
+            f_new = f(ctx, x_new, g_new);
+            if (!(f_new <= fx + LBFGS_C1 * t * dg)) {
+                hi = t;
+            } else if (lbfgs_dot(g_new, d, n) < LBFGS_C2 * dg) {
+                lo = t;
+            } else {
+                found = 1;
+                break;
+            }
+            t = isinf(hi) ? 2.0 * t : 0.5 * (lo + hi);
+        }
+        if (!found && lo > 0) {
+            // Out of trials with only the curvature condition failing: take the last sufficient decrease
+            for (int i = 0; i < n; i++) x_new[i] = x[i] + lo * d[i];
+            f_new = f(ctx, x_new, g_new);
+            found = f_new <= fx + LBFGS_C1 * lo * dg;
+        }
+        if (!found) {
+            // No step makes progress any more, x is a minimum to working precision
+            break;
+        }
+
+        double *s_head = S + (size_t)head * n;
+        double *y_head = Y + (size_t)head * n;
+        for (int i = 0; i < n; i++) {
+            s_head[i] = x_new[i] - x[i];
+            y_head[i] = g_new[i] - g[i];
+        }
+        const double sy = lbfgs_dot(s_head, y_head, n);
+        if (sy > 0) {
+            rho[head] = 1.0 / sy;
+            head = (head + 1) % m;
+            if (count < m) count++;
+        }
+
+        const double f_prev = fx;
+        memcpy(x, x_new, sizeof(double) * n);
+        memcpy(g, g_new, sizeof(double) * n);
+        fx = f_new;
+        if (f_prev - fx <= opt.tol * fmax(fabs(f_prev), 1.0)) {
+            iter++;
+            break;
+        }
+    }
+
+    free(buf);
+    return iter;
+}
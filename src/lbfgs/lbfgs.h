@@ -0,0 +1,23 @@
+#ifndef LBFGS_H
+#define LBFGS_H
+
+#define LBFGS_DEFAULT_HISTORY 10
+
+// Returns the loss at x (n parameters) and writes its gradient into grad. It is called at trial points of the line
+// search as well, so it must not assume x is the point that ends up accepted
+typedef double (*LbfgsObjective)(void *ctx, const double *x, double *grad);
+
+typedef struct {
+    int history;     // correction pairs kept (m)
+    int max_iters;
+    double tol;      // stop once |grad|_inf <= tol or the loss decreases by at most tol relative to its value
+    int print_every; // 0 prints nothing
+} LbfgsOptions;
+
+LbfgsOptions lbfgs_options_default(void);
+
+// Minimises f starting from x, which receives the result. Steps satisfy the weak Wolfe conditions, found by
+// bracketing. Returns the number of iterations run, or -1 on invalid arguments or allocation failure
+int lbfgs_minimize(LbfgsObjective f, void *ctx, int n, double *x, const LbfgsOptions *options);
+
+#endif
@@ -1,7 +1,10 @@
 ﻿#include "linear_regression.h"
+#include "../cholesky/cholesky.h"
+#include "../gemm/gemm.h"
 
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 LinearRegression *linear_regression_create(const int number_of_features, const int fit_intercept) {
     if (number_of_features < 1) {
@@ -28,6 +31,9 @@ LinearRegression *linear_regression_create(const int number_of_features, const i
     lr->lambda = NAN;
     lr->fit_intercept = fit_intercept;
     lr->number_of_features = number_of_features;
+    lr->gram = NULL;
+    lr->moment = NULL;
+    lr->samples_seen = 0;
 
     return lr;
 }
@@ -41,14 +47,67 @@ void linear_regression_free(LinearRegression *linear_regression) {
     if (linear_regression->coef) {
         vector_free(linear_regression->coef);
     }
+    if (linear_regression->gram) {
+        matrix_free(linear_regression->gram);
+    }
+    if (linear_regression->moment) {
+        vector_free(linear_regression->moment);
+    }
     free(linear_regression);
 }
 
 void linear_regression_fit(LinearRegression *model, Matrix *X, Vector *y, const double lambda) {
+    if (!X) {
+        NULL_ERROR("Matrix");
+        return;
+    }
+    if (!y) {
+        NULL_ERROR("Vector");
+        return;
+    }
+    linear_regression_fit_view(model, matrix_view(X), vector_view(y), lambda);
+}
+
+void linear_regression_fit_view(LinearRegression *model, const MatrixView X, const VectorView y, const double lambda) {
     if (!model) {
         NULL_ERROR("Linear regression model");
         return;
     }
+    if (model->gram) {
+        memset(model->gram->data, 0, sizeof(double) * model->gram->rows * model->gram->cols);
+        memset(model->moment->data, 0, sizeof(double) * model->moment->dim);
+        model->samples_seen = 0;
+    }
+
+    // Fitting is a single partial_fit on cleared statistics, those stay around for later batches or other lambdas
+    linear_regression_partial_fit_view(model, X, y);
+    if (!model->gram || model->samples_seen == 0) {
+        return;
+    }
+    linear_regression_finalize(model, lambda);
+}
+
+static int linear_regression_init_statistics(LinearRegression *model) {
+    if (model->gram) {
+        return 1;
+    }
+
+    const int size = model->fit_intercept ? model->number_of_features + 1 : model->number_of_features;
+    model->gram = matrix_create(size, size);
+    model->moment = vector_create(size);
+    if (!model->gram || !model->moment) {
+        ALLOCATION_ERROR();
+        if (model->gram) matrix_free(model->gram);
+        if (model->moment) vector_free(model->moment);
+        model->gram = NULL;
+        model->moment = NULL;
+        return 0;
+    }
+    model->samples_seen = 0;
+    return 1;
+}
+
+void linear_regression_partial_fit(LinearRegression *model, Matrix *X, Vector *y) {
     if (!X) {
         NULL_ERROR("Matrix");
         return;
@@ -57,110 +116,182 @@ void linear_regression_fit(LinearRegression *model, Matrix *X, Vector *y, const
         NULL_ERROR("Vector");
         return;
     }
-    if (X->rows != y->dim || X->cols != model->number_of_features) {
+    linear_regression_partial_fit_view(model, matrix_view(X), vector_view(y));
+}
+
+void linear_regression_partial_fit_view(LinearRegression *model, const MatrixView X, const VectorView y) {
+    if (!model) {
+        NULL_ERROR("Linear regression model");
+        return;
+    }
+    if (!X.data || !y.data) {
+        NULL_ERROR("View");
+        return;
+    }
+    if (X.rows != y.dim || X.cols != model->number_of_features) {
         CUSTOM_ERROR("X->rows must equal y->dim and X->cols must equal number_of_features");
         return;
     }
+    if (!linear_regression_init_statistics(model)) {
+        return;
+    }
 
-    const int n_features = X->cols;
-    const int n_samples = X->rows;
-    const int size = model->fit_intercept ? n_features + 1 : n_features;
-    model->lambda = lambda;
+    const int n_features = X.cols;
+    const int n_samples = X.rows;
+    const int size = model->gram->cols;
+    double *a = model->gram->data;
+    double *b = model->moment->data;
 
-    Matrix *A = matrix_create(size, size);
-    Vector *b = vector_create(size);
-
-    for (int i = 0; i < n_samples; i++) {
-        for (int row = 0; row < size; row++) {
-            double val_row;
-            if (model->fit_intercept) {
-                val_row = row == 0 ? 1.0 : matrix_get(X, i, row - 1);
-            } else {
-                val_row = matrix_get(X, i, row);
-            }
-
-            vector_set(b, row, vector_get(b, row) + val_row * vector_get(y, i));
-
-            for (int col = row; col < size; col++) {
-                double val_col;
-                if (model->fit_intercept) {
-                    val_col = col == 0 ? 1.0 : matrix_get(X, i, col - 1);
-                } else {
-                    val_col = matrix_get(X, i, col);
-                }
-
-                const double current_val = matrix_get(A, row, col);
-                const double new_val = current_val + val_row * val_col;
-                matrix_set(A, row, col, new_val);
-                if (row != col) {
-                    matrix_set(A, col, row, new_val);
-                }
-            }
+    // Upper triangle of the augmented Gram [1, X]^T [1, X]: the intercept row is the sample count and the column
+    // sums, everything else is X^T X, with [sum(y), X^T y] on the right
+    if (model->fit_intercept) {
+        double y_sum = 0;
+        for (int i = 0; i < n_samples; i++) {
+            y_sum += vector_view_get(y, i);
         }
+        a[0] += n_samples;
+        b[0] += y_sum;
+        gemm_syrk(n_features, n_samples, X.data, X.row_stride, X.col_stride, y.data, y.stride,
+                  a + size + 1, size, a + 1, b + 1);
+    } else {
+        gemm_syrk(n_features, n_samples, X.data, X.row_stride, X.col_stride, y.data, y.stride, a, size, NULL, b);
     }
+    model->samples_seen += n_samples;
+}
 
-    const int start_idx = model->fit_intercept ? 1 : 0;
-    for (int i = start_idx; i < size; i++) {
-        const double val = matrix_get(A, i, i);
-        matrix_set(A, i, i, val + lambda);
+void linear_regression_merge(LinearRegression *model, const LinearRegression *other) {
+    if (!model || !other) {
+        NULL_ERROR("Linear regression model");
+        return;
+    }
+    if (model->number_of_features != other->number_of_features || model->fit_intercept != other->fit_intercept) {
+        CUSTOM_ERROR("Models must have the same number_of_features and fit_intercept");
+        return;
+    }
+    if (!other->gram || model == other) {
+        return;
+    }
+    if (!linear_regression_init_statistics(model)) {
+        return;
     }
 
-    Matrix *A_inv = matrix_inverse(A, 0);
-    if (!A_inv) {
-        CUSTOM_ERROR("Matrix is singular");
-        matrix_free(A);
-        vector_free(b);
+    const size_t size = model->gram->cols;
+    for (size_t i = 0; i < size; i++) {
+        double *row = model->gram->data + i * size;
+        const double *other_row = other->gram->data + i * size;
+        for (size_t j = i; j < size; j++) {
+            row[j] += other_row[j];
+        }
+        model->moment->data[i] += other->moment->data[i];
+    }
+    model->samples_seen += other->samples_seen;
+}
+
+void linear_regression_finalize(LinearRegression *model, const double lambda) {
+    if (!model) {
+        NULL_ERROR("Linear regression model");
+        return;
+    }
+    if (!model->gram || model->samples_seen == 0) {
+        CUSTOM_ERROR("Model has no accumulated samples, call linear_regression_partial_fit first");
         return;
     }
 
-    if (model->fit_intercept) {
-        double inter_val = 0;
-        for (int j = 0; j < size; j++) inter_val += matrix_get(A_inv, 0, j) * vector_get(b, j);
-        model->intercept = inter_val;
+    const int size = model->gram->cols;
+    const int start_idx = model->fit_intercept ? 1 : 0;
+    model->lambda = lambda;
 
-        for (int i = 1; i < size; i++) {
-            double w_i = 0;
-            for (int j = 0; j < size; j++) w_i += matrix_get(A_inv, i, j) * vector_get(b, j);
-            vector_set(model->coef, i - 1, w_i);
+    // The statistics are kept intact for later batches and other lambdas, the solve runs on copies
+    Matrix *A = matrix_copy(model->gram);
+    Vector *b = vector_copy(model->moment);
+    if (!A || !b) {
+        ALLOCATION_ERROR();
+        if (A) matrix_free(A);
+        if (b) vector_free(b);
+        return;
+    }
+    double *a = A->data;
+
+    for (int i = start_idx; i < size; i++) {
+        a[(size_t)i * size + i] += lambda;
+    }
+
+    // A is symmetric with the upper triangle filled: Cholesky (or LDL^T) solves A w = b in place of b. Only when
+    // both break down does the pivoting inverse get the final say, A is restored for it
+    if (!cholesky_solve_symmetric(a, size, size, b->data)) {
+        Matrix *A_inv = matrix_inverse(A, 0);
+        double *w = malloc(sizeof(double) * size);
+        if (!A_inv || !w) {
+            CUSTOM_ERROR("Matrix is singular");
+            if (A_inv) matrix_free(A_inv);
+            free(w);
+            matrix_free(A);
+            vector_free(b);
+            return;
         }
-    } else {
         for (int i = 0; i < size; i++) {
+            const double *inv_row = A_inv->data + (size_t)i * size;
             double w_i = 0;
-            for (int j = 0; j < size; j++) w_i += matrix_get(A_inv, i, j) * vector_get(b, j);
-            vector_set(model->coef, i, w_i);
+            for (int j = 0; j < size; j++) w_i += inv_row[j] * b->data[j];
+            w[i] = w_i;
+        }
+        memcpy(b->data, w, sizeof(double) * size);
+        free(w);
+        matrix_free(A_inv);
+    }
+
+    for (int i = 0; i < size; i++) {
+        if (i < start_idx) {
+            model->intercept = b->data[i];
+        } else {
+            model->coef->data[i - start_idx] = b->data[i];
         }
     }
 
     matrix_free(A);
-    matrix_free(A_inv);
     vector_free(b);
 }
 
 Vector *linear_regression_predict(LinearRegression *model, Matrix *X) {
+    if (!X) {
+        NULL_ERROR("Matrix");
+        return NULL;
+    }
+    return linear_regression_predict_view(model, matrix_view(X));
+}
+
+Vector *linear_regression_predict_view(LinearRegression *model, const MatrixView X) {
     if (!model) {
         NULL_ERROR("Linear regression model");
         return NULL;
     }
-    if (!X) {
-        NULL_ERROR("Matrix");
+    if (!X.data) {
+        NULL_ERROR("MatrixView");
         return NULL;
     }
-    if (X->cols != model->number_of_features) {
+    if (X.cols != model->number_of_features) {
         CUSTOM_ERROR("X->cols must equal number_of_features");
         return NULL;
     }
 
-    Vector *res = vector_create(X->rows);
+    Vector *res = vector_create(X.rows);
+    double *row_buf = malloc(sizeof(double) * X.cols);
+    if (!res || !row_buf) {
+        ALLOCATION_ERROR();
+        if (res) vector_free(res);
+        free(row_buf);
+        return NULL;
+    }
+    const double *w = model->coef->data;
+    const double intercept = model->fit_intercept == 1 ? model->intercept : 0.0;
     for (int i = 0; i < res->dim; i++) {
+        const double *x = matrix_view_row(X, i, row_buf);
         double dot = 0;
         for (int j = 0; j < model->coef->dim; j++) {
-            dot += vector_get(model->coef, j) * matrix_get(X, i, j);
-        }
-        if (model->fit_intercept == 1) {
-            vector_set(res, i, dot + model->intercept);
-        } else {
-            vector_set(res, i, dot);
+            dot += w[j] * x[j];
         }
+        res->data[i] = model->fit_intercept == 1 ? dot + intercept : dot;
     }
+    free(row_buf);
     return res;
 }
\ No newline at end of file
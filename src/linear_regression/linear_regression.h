@@ -9,12 +9,26 @@ typedef struct {
     double lambda;
     int fit_intercept;
     int number_of_features;
+    // Sufficient statistics, allocated by the first (partial) fit: the upper triangle of [1, X]^T [1, X] (X^T X
+    // without the intercept), [sum(y), X^T y] and the number of rows seen
+    Matrix *gram;
+    Vector *moment;
+    long long samples_seen;
 } LinearRegression;
 
 LinearRegression *linear_regression_create(int number_of_features, int fit_intercept);
 void linear_regression_free(LinearRegression *linear_regression);
 
 void linear_regression_fit(LinearRegression *model, Matrix *X, Vector *y, double lambda);
+void linear_regression_fit_view(LinearRegression *model, MatrixView X, VectorView y, double lambda);
+// Incremental fitting: partial_fit adds a batch to the statistics, merge adds those of another model with the same
+// shape (e.g. fitted on another shard) and finalize solves for the given lambda, it can be called again with
+// another lambda or after more batches without rescanning the data
+void linear_regression_partial_fit(LinearRegression *model, Matrix *X, Vector *y);
+void linear_regression_partial_fit_view(LinearRegression *model, MatrixView X, VectorView y);
+void linear_regression_merge(LinearRegression *model, const LinearRegression *other);
+void linear_regression_finalize(LinearRegression *model, double lambda);
 Vector *linear_regression_predict(LinearRegression *model, Matrix *X);
+Vector *linear_regression_predict_view(LinearRegression *model, MatrixView X);
 
 #endif
\ No newline at end of file
@@ -1,9 +1,21 @@
 ﻿#include "logistic_regression.h"
+#include "../cholesky/cholesky.h"
+#include "../coordinate_descent/coordinate_descent.h"
+#include "../gemm/gemm.h"
+#include "../minibatch/minibatch.h"
 
+#include <float.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
+// Values of X scaled per gemm_syrk call when forming the Newton Hessian, and the line search's step halvings
+#define LOGISTIC_NEWTON_BLOCK (1 << 20)
+#define LOGISTIC_NEWTON_MAX_HALVINGS 30
+// Sweep cap of each inner coordinate descent solve
+#define LOGISTIC_CD_MAX_SWEEPS 1000
+
 LogisticRegression *logistic_regression_create(const int number_of_features, const int fit_intercept, const int random_seed, const double threshold, const Penalty penalty) {
     if (number_of_features < 1) {
         CUSTOM_ERROR("'number_of_features' must be at least 1");
@@ -30,8 +42,12 @@ LogisticRegression *logistic_regression_create(const int number_of_features, con
     lr->fit_intercept = fit_intercept;
     lr->number_of_features = number_of_features;
     lr->random_seed = random_seed;
+    lr->rng = NULL;
     lr->threshold = threshold;
     lr->penalty = penalty;
+    lr->solver = LOGISTIC_SGD;
+    lr->tol = 0;
+    lr->lbfgs_history = LBFGS_DEFAULT_HISTORY;
 
     return lr;
 }
@@ -47,198 +63,846 @@ void logistic_regression_free(LogisticRegression *model) {
     free(model);
 }
 
-void logistic_regression_fit(LogisticRegression *model, Matrix *X, Vector *y, const int batch, const double alpha, const int num_iters, double lambda, double ratio, const int print_every) {
+void logistic_regression_set_solver(LogisticRegression *model, const LogisticSolver solver, const double tol) {
     if (!model) {
         NULL_ERROR("LogisticRegression model");
         return;
     }
-    if (!X) {
-        NULL_ERROR("Matrix");
+    if (solver != LOGISTIC_SGD && solver != LOGISTIC_NEWTON && solver != LOGISTIC_LBFGS && solver != LOGISTIC_COORDINATE_DESCENT && solver != LOGISTIC_SGD_HOGWILD && solver != LOGISTIC_SGD_SYNC) {
+        CUSTOM_ERROR("Unknown solver");
         return;
     }
-    if (!y) {
-        NULL_ERROR("Vector");
+    if (tol < 0 || isnan(tol)) {
+        CUSTOM_ERROR("'tol' must be non-negative");
         return;
     }
-    if (X->rows != y->dim || X->cols != model->number_of_features) {
-        CUSTOM_ERROR("X->rows must equal y->dim and X->cols must equal number_of_features");
+    model->solver = solver;
+    model->tol = tol;
+}
+
+void logistic_regression_set_rng(LogisticRegression *model, pcg32_random_t *rng) {
+    if (!model) {
+        NULL_ERROR("LogisticRegression model");
         return;
     }
+    model->rng = rng;
+}
+
+static int logistic_regression_check_parameters(const LogisticRegression *model, const double alpha, const int num_iters, const double lambda, const double ratio, const int print_every) {
     if (num_iters < 1) {
         CUSTOM_ERROR("'num_iters' must be at least 1");
-        return;
+        return 0;
     }
     if (alpha < 0) {
         CUSTOM_ERROR("'alpha' must be non-negative");
-        return;
+        return 0;
     }
     if (print_every < 0) {
         CUSTOM_ERROR("'print_every' must be non-negative");
-        return;
+        return 0;
     }
 
     switch (model->penalty) {
         case NO_PENALTY: {
             if (!isnan(lambda) || !isnan(ratio)) {
                 CUSTOM_ERROR("'lambda' and 'ratio' are unused with NO_PENALTY, pass NAN");
-                return;
+                return 0;
             }
             break;
         }
         case L1_LASSO: {
             if (!isnan(ratio)) {
                 CUSTOM_ERROR("'ratio' is unused with L1_LASSO, pass NAN");
-                return;
+                return 0;
             }
             if (lambda < 0 || isnan(lambda)) {
                 CUSTOM_ERROR("'lambda' must be non-negative");
-                return;
+                return 0;
             }
             break;
         }
         case L2_RIDGE: {
             if (!isnan(ratio)) {
                 CUSTOM_ERROR("'ratio' is unused with L2_RIDGE, pass NAN");
-                return;
+                return 0;
             }
             if (lambda < 0 || isnan(lambda)) {
                 CUSTOM_ERROR("'lambda' must be non-negative");
-                return;
+                return 0;
             }
             break;
         }
         case ELASTIC_NET: {
             if (lambda < 0 || isnan(lambda)) {
                 CUSTOM_ERROR("'lambda' must be non-negative");
-                return;
+                return 0;
             }
             if (ratio < 0 || ratio > 1 || isnan(ratio)) {
                 CUSTOM_ERROR("'ratio' must be between 0 and 1");
-                return;
+                return 0;
             }
             break;
         }
     }
+    return 1;
+}
 
+// The generator of a fit: the caller's when one is set, otherwise seeded from random_seed so that every fit draws
+// the same numbers
+static pcg32_random_t *logistic_regression_rng(const LogisticRegression *model, pcg32_random_t *seeded) {
+    if (model->rng) {
+        return model->rng;
+    }
     const uint64_t seed = model->random_seed < 0 ? (uint64_t)time(NULL) : (uint64_t)model->random_seed;
-    pcg32_seed(seed);
+    pcg32_seed_r(seeded, seed);
+    return seeded;
+}
 
-    const double limit = math_xavier(X->cols, 1);
+static void logistic_regression_initialize(LogisticRegression *model, pcg32_random_t *rng, const double lambda, const double ratio) {
+    const double limit = math_xavier(model->number_of_features, 1);
     for (int i = 0; i < model->number_of_features; i++) {
-        const double random_w = pcg32_random_double() * 2.0 * limit - limit;
+        const double random_w = pcg32_random_double_r(rng) * 2.0 * limit - limit;
         vector_set(model->coef, i, random_w);
     }
     model->intercept = 0;
     model->lambda = lambda;
     model->ratio = ratio;
+}
 
-    Vector *indices = vector_create(X->rows);
-    for (int i = 0; i < indices->dim; i++) {
-        vector_set(indices, i, i);
+// Summed loss and gradient of n rows of X (row stride ldx) with targets y[i * y_stride] at the current coefficients:
+// grad receives number_of_features values and *intercept_grad the intercept's, y_hats is scratch for n. Predictions
+// and the gradient are a GEMV and a transposed GEMV over the batch
+static double logistic_regression_gradient(const void *ctx, const double *X, const int ldx, const double *y, const int y_stride, const int n, double *grad, double *intercept_grad, double *y_hats) {
+    const LogisticRegression *model = ctx;
+    const int n_features = model->number_of_features;
+    double loss = 0;
+    double intercept_grad_sum = 0;
+
+    gemm_gemv(0, n, n_features, X, ldx, model->coef->data, y_hats);
+    if (model->fit_intercept) {
+        for (int i = 0; i < n; i++) {
+            y_hats[i] += model->intercept;
+        }
     }
+    math_sigmoid_array(y_hats, y_hats, n);
 
-    for (int iter = 0; iter < num_iters; iter++) {
-        vector_shuffle(indices);
-        double total_epoch_loss = 0;
+    // y_hats turns into the residuals, the weights of the transposed product
+    for (int i = 0; i < n; i++) {
+        const double y_hat = y_hats[i];
+        const double y_true = y[(size_t)i * y_stride];
+        const double error = y_hat - y_true;
 
-        for (int k = 0; k < X->rows; k += batch) {
-            const int current_batch_size = k + batch > X->rows ? X->rows - k : batch;
+        const double eps = 1e-15;
+        loss += -1 * y_true * log(y_hat + eps) - (1 - y_true) * log(1 - y_hat + eps);
+        intercept_grad_sum += error;
+        y_hats[i] = error;
+    }
+    gemm_gemv(1, n, n_features, X, ldx, y_hats, grad);
 
-            Vector *grad_sums = vector_create(model->number_of_features);
-            double intercept_grad_sum = 0;
+    *intercept_grad = intercept_grad_sum;
+    return loss;
+}
 
-            for (int i = 0; i < current_batch_size; i++) {
-                const int row_idx = (int)vector_get(indices, k + i);
+// Gradient step for the summed gradient of n rows, together with the penalty
+static void logistic_regression_update(void *ctx, const double *grad, const double intercept_grad, const int n, const double alpha, const double lambda, const double ratio) {
+    LogisticRegression *model = ctx;
+    double *w = model->coef->data;
+    for (int j = 0; j < model->number_of_features; j++) {
+        const double grad_j = grad[j] / n;
+        double w_j = w[j];
 
-                double dot = 0;
-                for (int j = 0; j < model->number_of_features; j++) {
-                    dot += matrix_get(X, row_idx, j) * vector_get(model->coef, j);
+        switch (model->penalty) {
+            case L2_RIDGE:
+                w_j -= alpha * (grad_j + lambda * w_j);
+                break;
+            case L1_LASSO:
+                w_j -= alpha * (grad_j + lambda * (w_j > 0 ? 1 : -1));
+                break;
+            case ELASTIC_NET: {
+                const double l1 = ratio * (w_j > 0 ? 1 : -1);
+                const double l2 = (1.0 - ratio) * w_j;
+                w_j -= alpha * (grad_j + lambda * (l1 + l2));
+                break;
+            }
+            default:
+                w_j -= alpha * grad_j;
+                break;
+        }
+        w[j] = w_j;
+    }
+
+    if (model->fit_intercept) {
+        model->intercept -= alpha * (intercept_grad / n);
+    }
+}
+
+// One minibatch update, see logistic_regression_gradient. Returns the summed loss of the batch before the update
+static double logistic_regression_step(LogisticRegression *model, const double *X, const int ldx, const double *y, const int y_stride, const int n, double *grad, double *y_hats, const double alpha, const double lambda, const double ratio) {
+    double intercept_grad;
+    const double loss = logistic_regression_gradient(model, X, ldx, y, y_stride, n, grad, &intercept_grad, y_hats);
+    logistic_regression_update(model, grad, intercept_grad, n, alpha, lambda, ratio);
+    return loss;
+}
+
+// log(1 + e^z) - y z, the cross-entropy of sigmoid(z) without cancellation for large |z|
+static double logistic_regression_log_loss(const double z, const double y) {
+    const double softplus = z > 0 ? z + log1p(exp(-z)) : log1p(exp(z));
+    return softplus - y * z;
+}
+
+static double logistic_regression_objective(const LogisticRegression *model, const MatrixView X, const VectorView y, const double *w, const double intercept, const double ridge, double *row_buf) {
+    const int n_features = model->number_of_features;
+    double loss = 0;
+    for (int i = 0; i < X.rows; i++) {
+        const double *x = matrix_view_row(X, i, row_buf);
+        double z = model->fit_intercept ? intercept : 0.0;
+        for (int j = 0; j < n_features; j++) {
+            z += x[j] * w[j];
+        }
+        loss += logistic_regression_log_loss(z, vector_view_get(y, i));
+    }
+    double norm = 0;
+    for (int j = 0; j < n_features; j++) {
+        norm += w[j] * w[j];
+    }
+    return loss / X.rows + 0.5 * ridge * norm;
+}
+
+// Minimises the mean cross-entropy + ridge / 2 * ||w||^2 (the objective the SGD steps follow) from w = 0. Every
+// iteration accumulates the gradient and, through gemm_syrk on blocks of rows scaled by sqrt(p (1 - p)), the
+// Hessian [1, X]^T W [1, X] / n + ridge, then takes the Cholesky-solved Newton step with backtracking
+static void logistic_regression_fit_newton(LogisticRegression *model, const MatrixView X, const VectorView y, const int num_iters, const double lambda, const int print_every) {
+    const int n_features = model->number_of_features;
+    const int offset = model->fit_intercept;
+    const int size = n_features + offset;
+    const double ridge = model->penalty == L2_RIDGE ? lambda : 0.0;
+    int block_rows = LOGISTIC_NEWTON_BLOCK / n_features;
+    if (block_rows < 1) block_rows = 1;
+    if (block_rows > X.rows) block_rows = X.rows;
+
+    double *H = malloc(sizeof(double) * size * size);
+    double *grad = malloc(sizeof(double) * size);
+    double *step = malloc(sizeof(double) * size);
+    double *w_new = malloc(sizeof(double) * n_features);
+    double *Z = malloc(sizeof(double) * block_rows * n_features);
+    double *sqrt_weights = malloc(sizeof(double) * block_rows);
+    double *row_buf = malloc(sizeof(double) * n_features);
+    if (!H || !grad || !step || !w_new || !Z || !sqrt_weights || !row_buf) {
+        ALLOCATION_ERROR();
+        free(H);
+        free(grad);
+        free(step);
+        free(w_new);
+        free(Z);
+        free(sqrt_weights);
+        free(row_buf);
+        return;
+    }
+
+    double *w = model->coef->data;
+    memset(w, 0, sizeof(double) * n_features);
+    model->intercept = 0;
+
+    for (int iter = 0; iter < num_iters; iter++) {
+        memset(H, 0, sizeof(double) * size * size);
+        memset(grad, 0, sizeof(double) * size);
+        double loss = 0;
+
+        for (int start = 0; start < X.rows; start += block_rows) {
+            const int rows = X.rows - start < block_rows ? X.rows - start : block_rows;
+            for (int i = 0; i < rows; i++) {
+                const double *x = matrix_view_row(X, start + i, row_buf);
+                double z = offset ? model->intercept : 0.0;
+                for (int j = 0; j < n_features; j++) {
+                    z += x[j] * w[j];
+                }
+                const double y_i = vector_view_get(y, start + i);
+                const double p = 1.0 / (1.0 + exp(-z));
+                const double error = p - y_i;
+                loss += logistic_regression_log_loss(z, y_i);
+
+                for (int j = 0; j < n_features; j++) {
+                    grad[offset + j] += error * x[j];
                 }
-                if (model->fit_intercept) {
-                    dot += model->intercept;
+                if (offset) {
+                    grad[0] += error;
+                    H[0] += p * (1.0 - p);
                 }
 
-                const double y_hat = math_sigmoid(dot);
-                const double error = y_hat - vector_get(y, row_idx);
+                const double s = sqrt(p * (1.0 - p));
+                double *z_row = Z + (size_t)i * n_features;
+                for (int j = 0; j < n_features; j++) {
+                    z_row[j] = s * x[j];
+                }
+                sqrt_weights[i] = s;
+            }
+            // Z^T Z = X^T W X and Z^T sqrt(w) = X^T w, the intercept row of the Hessian
+            if (offset) {
+                gemm_syrk(n_features, rows, Z, n_features, 1, sqrt_weights, 1, H + size + 1, size, NULL, H + 1);
+            } else {
+                gemm_syrk(n_features, rows, Z, n_features, 1, NULL, 0, H, size, NULL, NULL);
+            }
+        }
+
+        const double inv_n = 1.0 / X.rows;
+        double norm = 0;
+        for (size_t i = 0; i < (size_t)size * size; i++) {
+            H[i] *= inv_n;
+        }
+        for (int i = 0; i < size; i++) {
+            grad[i] *= inv_n;
+        }
+        for (int j = 0; j < n_features; j++) {
+            H[(size_t)(offset + j) * (size + 1)] += ridge;
+            grad[offset + j] += ridge * w[j];
+            norm += w[j] * w[j];
+        }
+        loss = loss * inv_n + 0.5 * ridge * norm;
+
+        if (print_every > 0 && iter % print_every == 0) {
+            printf("Iteration: %d | Cost (LOSS): [%lf]\n", iter + 1, loss);
+        }
 
-                const double eps = 1e-15;
-                total_epoch_loss += -1 * vector_get(y, row_idx) * log(y_hat + eps) - (1 - vector_get(y, row_idx)) * log(1 - y_hat + eps);
+        memcpy(step, grad, sizeof(double) * size);
+        if (!cholesky_solve_symmetric(H, size, size, step)) {
+            CUSTOM_WARNING("Hessian is singular, stopping after %d iterations", iter);
+            break;
+        }
+        double decrement = 0;
+        for (int i = 0; i < size; i++) {
+            decrement += grad[i] * step[i];
+        }
+        // A decrement at rounding level means the loss cannot improve any further, whatever tol is
+        if (!(decrement > 2.0 * model->tol) || decrement <= DBL_EPSILON * fabs(loss)) {
+            break;
+        }
 
-                for (int j = 0; j < model->number_of_features; j++) {
-                    vector_set(grad_sums, j, vector_get(grad_sums, j) + error * matrix_get(X, row_idx, j));
-                }
-                intercept_grad_sum += error;
-            }
-
-            for (int j = 0; j < model->number_of_features; j++) {
-                const double grad_j = vector_get(grad_sums, j) / current_batch_size;
-                double w_j = vector_get(model->coef, j);
-
-                switch (model->penalty) {
-                    case L2_RIDGE:
-                        w_j -= alpha * (grad_j + lambda * w_j);
-                        break;
-                    case L1_LASSO:
-                        w_j -= alpha * (grad_j + lambda * (w_j > 0 ? 1 : -1));
-                        break;
-                    case ELASTIC_NET: {
-                        const double l1 = ratio * (w_j > 0 ? 1 : -1);
-                        const double l2 = (1.0 - ratio) * w_j;
-                        w_j -= alpha * (grad_j + lambda * (l1 + l2));
-                        break;
+        // Halve the step until it achieves a quarter of the decrease the quadratic model predicts and strictly
+        // lowers the objective, stopping once no step does
+        double t = 1.0;
+        int accepted = 0;
+        for (int halving = 0; halving <= LOGISTIC_NEWTON_MAX_HALVINGS && !accepted; halving++) {
+            for (int j = 0; j < n_features; j++) {
+                w_new[j] = w[j] - t * step[offset + j];
+            }
+            const double intercept_new = offset ? model->intercept - t * step[0] : 0.0;
+            const double objective = logistic_regression_objective(model, X, y, w_new, intercept_new, ridge, row_buf);
+            if (objective < loss && objective <= loss - 0.25 * t * decrement) {
+                memcpy(w, w_new, sizeof(double) * n_features);
+                model->intercept = intercept_new;
+                accepted = 1;
+            }
+            t *= 0.5;
+        }
+        if (!accepted) {
+            break;
+        }
+    }
+
+    free(H);
+    free(grad);
+    free(step);
+    free(w_new);
+    free(Z);
+    free(sqrt_weights);
+    free(row_buf);
+}
+
+typedef struct {
+    const LogisticRegression *model;
+    MatrixView X;
+    VectorView y;
+    double ridge;
+    double *row_buf;
+} LogisticLbfgsTask;
+
+// The objective of logistic_regression_fit_newton over the parameters [w, intercept]
+static double logistic_regression_lbfgs_objective(void *ctx, const double *params, double *grad) {
+    const LogisticLbfgsTask *t = ctx;
+    const int n_features = t->model->number_of_features;
+    const int fit_intercept = t->model->fit_intercept;
+    const double intercept = fit_intercept ? params[n_features] : 0.0;
+    memset(grad, 0, sizeof(double) * (n_features + fit_intercept));
+
+    double loss = 0;
+    for (int i = 0; i < t->X.rows; i++) {
+        const double *x = matrix_view_row(t->X, i, t->row_buf);
+        double z = intercept;
+        for (int j = 0; j < n_features; j++) {
+            z += x[j] * params[j];
+        }
+        const double y_i = vector_view_get(t->y, i);
+        const double error = 1.0 / (1.0 + exp(-z)) - y_i;
+        loss += logistic_regression_log_loss(z, y_i);
+
+        for (int j = 0; j < n_features; j++) {
+            grad[j] += error * x[j];
+        }
+        if (fit_intercept) {
+            grad[n_features] += error;
+        }
+    }
+
+    const double inv_n = 1.0 / t->X.rows;
+    double norm = 0;
+    for (int j = 0; j < n_features + fit_intercept; j++) {
+        grad[j] *= inv_n;
+    }
+    for (int j = 0; j < n_features; j++) {
+        grad[j] += t->ridge * params[j];
+        norm += params[j] * params[j];
+    }
+    return loss * inv_n + 0.5 * t->ridge * norm;
+}
+
+static void logistic_regression_fit_lbfgs(LogisticRegression *model, const MatrixView X, const VectorView y, const int num_iters, const double lambda, const int print_every) {
+    const int n_features = model->number_of_features;
+    const int n_params = n_features + model->fit_intercept;
+    double *params = calloc(n_params, sizeof(double));
+    double *row_buf = malloc(sizeof(double) * n_features);
+    if (!params || !row_buf) {
+        ALLOCATION_ERROR();
+        free(params);
+        free(row_buf);
+        return;
+    }
+
+    LogisticLbfgsTask task = {model, X, y, model->penalty == L2_RIDGE ? lambda : 0.0, row_buf};
+    const LbfgsOptions options = {model->lbfgs_history, num_iters, model->tol, print_every};
+    if (lbfgs_minimize(logistic_regression_lbfgs_objective, &task, n_params, params, &options) >= 0) {
+        memcpy(model->coef->data, params, sizeof(double) * n_features);
+        model->intercept = model->fit_intercept ? params[n_features] : 0.0;
+    }
+    free(params);
+    free(row_buf);
+}
+
+// Share of the penalty that is L1, in the form coordinate_descent_solve takes
+static double logistic_regression_l1_ratio(const LogisticRegression *model, const double ratio) {
+    switch (model->penalty) {
+        case L1_LASSO:
+            return 1.0;
+        case ELASTIC_NET:
+            return ratio;
+        default:
+            return 0.0;
+    }
+}
+
+static double logistic_regression_penalty_value(const double *w, const int n, const double lambda, const double l1_ratio) {
+    double l1 = 0;
+    double l2 = 0;
+    for (int j = 0; j < n; j++) {
+        l1 += fabs(w[j]);
+        l2 += w[j] * w[j];
+    }
+    return lambda * (l1_ratio * l1 + 0.5 * (1.0 - l1_ratio) * l2);
+}
+
+// The weighted least squares approximation at the current coefficients, with W = p (1 - p) and the working response
+// eta + (y - p) / W, is 1 / (2n) sum W (z - b - x w)^2. Eliminating b leaves 0.5 w^T Q w - c^T w with
+// Q = (X^T W X - m m^T / S) / n and c = (X^T (W eta + y - p) - m r0 / S) / n, where m = X^T W 1, S = sum W and
+// r0 = sum (W eta + y - p); b = (r0 - m w) / S. Without an intercept only the first terms remain
+static void logistic_regression_coordinate_descent(LogisticRegression *model, const MatrixView X, const VectorView y, const double *lambdas, const int num_lambdas, const double ratio, const int max_iters, const int print_every, Matrix *coefs, Vector *intercepts) {
+    const int n_features = model->number_of_features;
+    const int fit_intercept = model->fit_intercept;
+    const size_t gram_size = (size_t)n_features * n_features;
+    int block_rows = LOGISTIC_NEWTON_BLOCK / n_features;
+    if (block_rows < 1) block_rows = 1;
+    if (block_rows > X.rows) block_rows = X.rows;
+
+    double *G = malloc(sizeof(double) * gram_size);
+    double *Q = malloc(sizeof(double) * gram_size);
+    double *vectors = malloc(sizeof(double) * 7 * n_features);
+    double *Z = malloc(sizeof(double) * block_rows * n_features);
+    double *sqrt_weights = malloc(sizeof(double) * block_rows);
+    if (!G || !Q || !vectors || !Z || !sqrt_weights) {
+        ALLOCATION_ERROR();
+        free(G);
+        free(Q);
+        free(vectors);
+        free(Z);
+        free(sqrt_weights);
+        return;
+    }
+    double *m = vectors;
+    double *r = m + n_features;
+    double *c = r + n_features;
+    double *Qw = c + n_features;
+    double *w_cd = Qw + n_features;
+    double *w_trial = w_cd + n_features;
+    double *row_buf = w_trial + n_features;
+
+    const double l1_ratio = logistic_regression_l1_ratio(model, ratio);
+    double *w = model->coef->data;
+    memset(w, 0, sizeof(double) * n_features);
+    model->intercept = 0;
+
+    for (int k = 0; k < num_lambdas; k++) {
+        const double lambda = model->penalty == NO_PENALTY ? 0.0 : lambdas[k];
+        double objective = logistic_regression_objective(model, X, y, w, model->intercept, 0.0, row_buf) + logistic_regression_penalty_value(w, n_features, lambda, l1_ratio);
+
+        int iter;
+        for (iter = 0; iter < max_iters; iter++) {
+            memset(G, 0, sizeof(double) * gram_size);
+            memset(m, 0, sizeof(double) * n_features);
+            memset(r, 0, sizeof(double) * n_features);
+            double S = 0;
+            double r0 = 0;
+
+            for (int start = 0; start < X.rows; start += block_rows) {
+                const int rows = X.rows - start < block_rows ? X.rows - start : block_rows;
+                for (int i = 0; i < rows; i++) {
+                    const double *x = matrix_view_row(X, start + i, row_buf);
+                    double eta = fit_intercept ? model->intercept : 0.0;
+                    for (int j = 0; j < n_features; j++) {
+                        eta += x[j] * w[j];
+                    }
+                    const double p = 1.0 / (1.0 + exp(-eta));
+                    const double weight = p * (1.0 - p);
+                    const double t = weight * eta + vector_view_get(y, start + i) - p;
+                    for (int j = 0; j < n_features; j++) {
+                        r[j] += t * x[j];
+                    }
+                    r0 += t;
+                    S += weight;
+
+                    const double s = sqrt(weight);
+                    double *z_row = Z + (size_t)i * n_features;
+                    for (int j = 0; j < n_features; j++) {
+                        z_row[j] = s * x[j];
                     }
-                    default:
-                        w_j -= alpha * grad_j;
-                        break;
+                    sqrt_weights[i] = s;
+                }
+                gemm_syrk(n_features, rows, Z, n_features, 1, sqrt_weights, 1, G, n_features, NULL, fit_intercept ? m : NULL);
+            }
+            if (fit_intercept && !(S > 0)) {
+                break;
+            }
+
+            const double inv_n = 1.0 / X.rows;
+            for (int j = 0; j < n_features; j++) {
+                for (int l = j; l < n_features; l++) {
+                    double q = G[(size_t)j * n_features + l];
+                    if (fit_intercept) q -= m[j] * m[l] / S;
+                    Q[(size_t)j * n_features + l] = q * inv_n;
+                    Q[(size_t)l * n_features + j] = q * inv_n;
                 }
-                vector_set(model->coef, j, w_j);
+                c[j] = (fit_intercept ? r[j] - m[j] * r0 / S : r[j]) * inv_n;
+            }
+
+            // Warm start from the current coefficients, the strong rule only holds on the first iteration where
+            // they solve the previous lambda
+            memcpy(w_cd, w, sizeof(double) * n_features);
+            for (int j = 0; j < n_features; j++) {
+                const double *q_j = Q + (size_t)j * n_features;
+                double sum = 0;
+                for (int l = 0; l < n_features; l++) sum += q_j[l] * w_cd[l];
+                Qw[j] = sum;
+            }
+            const double lambda_prev = iter == 0 && k > 0 ? lambdas[k - 1] : NAN;
+            coordinate_descent_solve(Q, n_features, n_features, c, lambda, l1_ratio, lambda_prev, model->tol, LOGISTIC_CD_MAX_SWEEPS, w_cd, Qw);
+            double intercept_cd = 0;
+            if (fit_intercept) {
+                intercept_cd = r0;
+                for (int j = 0; j < n_features; j++) intercept_cd -= m[j] * w_cd[j];
+                intercept_cd /= S;
             }
 
-            if (model->fit_intercept) {
-                model->intercept -= alpha * (intercept_grad_sum / current_batch_size);
+            double step = 1.0;
+            int accepted = 0;
+            int converged = 0;
+            for (int halving = 0; halving <= LOGISTIC_NEWTON_MAX_HALVINGS && !accepted; halving++) {
+                for (int j = 0; j < n_features; j++) {
+                    w_trial[j] = w[j] + step * (w_cd[j] - w[j]);
+                }
+                const double intercept_trial = model->intercept + step * (intercept_cd - model->intercept);
+                const double trial = logistic_regression_objective(model, X, y, w_trial, intercept_trial, 0.0, row_buf) + logistic_regression_penalty_value(w_trial, n_features, lambda, l1_ratio);
+                if (trial <= objective) {
+                    converged = objective - trial <= model->tol * objective;
+                    memcpy(w, w_trial, sizeof(double) * n_features);
+                    model->intercept = intercept_trial;
+                    objective = trial;
+                    accepted = 1;
+                }
+                step *= 0.5;
+            }
+            if (!accepted || converged) {
+                iter++;
+                break;
             }
-            vector_free(grad_sums);
         }
 
-        if (print_every > 0 && (iter % print_every == 0 || iter == num_iters - 1)) {
-            printf("Epoch: %d | Cost (LOSS): [%lf]\n", iter + 1, total_epoch_loss / X->rows);
+        int nonzero = 0;
+        for (int j = 0; j < n_features; j++) {
+            nonzero += w[j] != 0.0;
+        }
+        if (coefs) {
+            memcpy(coefs->data + (size_t)k * n_features, w, sizeof(double) * n_features);
+        }
+        if (intercepts) {
+            intercepts->data[k] = model->intercept;
+        }
+        if (print_every > 0 && (k % print_every == 0 || k == num_lambdas - 1)) {
+            printf("Lambda: %lf | Iterations: %d | Cost (LOSS): [%lf] | Nonzero: %d\n", lambda, iter, objective, nonzero);
         }
     }
-    vector_free(indices);
+
+    free(G);
+    free(Q);
+    free(vectors);
+    free(Z);
+    free(sqrt_weights);
 }
 
-Vector *logistic_regression_predict_proba(LogisticRegression *model, Matrix *X) {
+void logistic_regression_fit(LogisticRegression *model, Matrix *X, Vector *y, const int batch, const double alpha, const int num_iters, double lambda, double ratio, const int print_every) {
+    if (!X) {
+        NULL_ERROR("Matrix");
+        return;
+    }
+    if (!y) {
+        NULL_ERROR("Vector");
+        return;
+    }
+    logistic_regression_fit_view(model, matrix_view(X), vector_view(y), batch, alpha, num_iters, lambda, ratio, print_every);
+}
+
+void logistic_regression_fit_view(LogisticRegression *model, const MatrixView X, const VectorView y, const int batch, const double alpha, const int num_iters, double lambda, double ratio, const int print_every) {
+    if (!model) {
+        NULL_ERROR("LogisticRegression model");
+        return;
+    }
+    if (!X.data || !y.data) {
+        NULL_ERROR("View");
+        return;
+    }
+    if (X.rows != y.dim || X.cols != model->number_of_features) {
+        CUSTOM_ERROR("X.rows must equal y.dim and X.cols must equal number_of_features");
+        return;
+    }
+    if (batch < 1) {
+        CUSTOM_ERROR("'batch' must be at least 1");
+        return;
+    }
+    if (!logistic_regression_check_parameters(model, alpha, num_iters, lambda, ratio, print_every)) {
+        return;
+    }
+    if (model->solver == LOGISTIC_COORDINATE_DESCENT) {
+        model->lambda = lambda;
+        model->ratio = ratio;
+        logistic_regression_coordinate_descent(model, X, y, &lambda, 1, ratio, num_iters, print_every, NULL, NULL);
+        return;
+    }
+    if (model->solver == LOGISTIC_NEWTON || model->solver == LOGISTIC_LBFGS) {
+        if (model->penalty != NO_PENALTY && model->penalty != L2_RIDGE) {
+            CUSTOM_ERROR("The Newton and L-BFGS solvers support NO_PENALTY and L2_RIDGE only");
+            return;
+        }
+        model->lambda = lambda;
+        model->ratio = ratio;
+        if (model->solver == LOGISTIC_NEWTON) {
+            logistic_regression_fit_newton(model, X, y, num_iters, lambda, print_every);
+        } else {
+            logistic_regression_fit_lbfgs(model, X, y, num_iters, lambda, print_every);
+        }
+        return;
+    }
+    pcg32_random_t seeded;
+    pcg32_random_t *rng = logistic_regression_rng(model, &seeded);
+    logistic_regression_initialize(model, rng, lambda, ratio);
+
+    const MinibatchModel minibatch_model = {model, model->number_of_features, logistic_regression_gradient, logistic_regression_update};
+    const MinibatchSchedule schedule = model->solver == LOGISTIC_SGD_HOGWILD ? MINIBATCH_HOGWILD : model->solver == LOGISTIC_SGD_SYNC ? MINIBATCH_SYNC : MINIBATCH_SERIAL;
+    MinibatchTrainer trainer;
+    if (!minibatch_init(&trainer, minibatch_model, schedule, rng, X, y, batch, alpha, lambda, ratio)) {
+        return;
+    }
+
+    double previous_loss = 0;
+    for (int iter = 0; iter < num_iters; iter++) {
+        const double total_epoch_loss = minibatch_epoch(&trainer);
+
+        const double epoch_loss = total_epoch_loss / X.rows;
+        const int converged = model->tol > 0 && iter > 0 && fabs(previous_loss - epoch_loss) <= model->tol * previous_loss;
+        if (print_every > 0 && (iter % print_every == 0 || iter == num_iters - 1 || converged)) {
+            printf("Epoch: %d | Cost (LOSS): [%lf]\n", iter + 1, epoch_loss);
+        }
+        if (converged) {
+            break;
+        }
+        previous_loss = epoch_loss;
+    }
+    minibatch_free(&trainer);
+}
+
+void logistic_regression_fit_stream(LogisticRegression *model, CsvStream *stream, const int batch, const double alpha, const int num_iters, const double lambda, const double ratio, const int print_every) {
+    if (!model) {
+        NULL_ERROR("LogisticRegression model");
+        return;
+    }
+    if (!stream) {
+        NULL_ERROR("CsvStream");
+        return;
+    }
+    if (stream->cols != model->number_of_features + 1) {
+        CUSTOM_ERROR("Stream must have number_of_features + 1 columns (features, then the target)");
+        return;
+    }
+    if (batch < 1) {
+        CUSTOM_ERROR("'batch' must be at least 1");
+        return;
+    }
+    if (!logistic_regression_check_parameters(model, alpha, num_iters, lambda, ratio, print_every)) {
+        return;
+    }
+    if (model->solver != LOGISTIC_SGD) {
+        CUSTOM_ERROR("Streams are trained with LOGISTIC_SGD only");
+        return;
+    }
+
+    Matrix *rows = matrix_create(batch, stream->cols);
+    Vector *grad_sums = vector_create(model->number_of_features);
+    Vector *y_hats = vector_create(batch);
+    if (!rows || !grad_sums || !y_hats) {
+        ALLOCATION_ERROR();
+        if (rows) matrix_free(rows);
+        if (grad_sums) vector_free(grad_sums);
+        if (y_hats) vector_free(y_hats);
+        return;
+    }
+    pcg32_random_t seeded;
+    logistic_regression_initialize(model, logistic_regression_rng(model, &seeded), lambda, ratio);
+
+    double previous_loss = 0;
+    for (int iter = 0; iter < num_iters; iter++) {
+        csv_stream_rewind(stream);
+        double total_epoch_loss = 0;
+        long long seen = 0;
+
+        int n;
+        while ((n = csv_stream_next_batch(stream, rows, batch)) > 0) {
+            total_epoch_loss += logistic_regression_step(model, rows->data, rows->cols, rows->data + model->number_of_features, rows->cols, n, grad_sums->data, y_hats->data, alpha, lambda, ratio);
+            seen += n;
+        }
+
+        const double epoch_loss = total_epoch_loss / (double)seen;
+        const int converged = model->tol > 0 && iter > 0 && fabs(previous_loss - epoch_loss) <= model->tol * previous_loss;
+        if (print_every > 0 && (iter % print_every == 0 || iter == num_iters - 1 || converged)) {
+            printf("Epoch: %d | Cost (LOSS): [%lf]\n", iter + 1, epoch_loss);
+        }
+        if (converged) {
+            break;
+        }
+        previous_loss = epoch_loss;
+    }
+    matrix_free(rows);
+    vector_free(grad_sums);
+    vector_free(y_hats);
+}
+
+Matrix *logistic_regression_path(LogisticRegression *model, const MatrixView X, const VectorView y, const double *lambdas, const int num_lambdas, const double ratio, const int num_iters, Vector **intercepts) {
     if (!model) {
         NULL_ERROR("LogisticRegression model");
         return NULL;
     }
+    if (!X.data || !y.data || !lambdas) {
+        NULL_ERROR("View or lambdas");
+        return NULL;
+    }
+    if (X.rows != y.dim || X.cols != model->number_of_features) {
+        CUSTOM_ERROR("X.rows must equal y.dim and X.cols must equal number_of_features");
+        return NULL;
+    }
+    if (model->penalty == NO_PENALTY) {
+        CUSTOM_ERROR("A regularization path needs a penalty");
+        return NULL;
+    }
+    if (num_lambdas < 1) {
+        CUSTOM_ERROR("'num_lambdas' must be at least 1");
+        return NULL;
+    }
+    for (int k = 0; k < num_lambdas; k++) {
+        if (!logistic_regression_check_parameters(model, 0, num_iters, lambdas[k], ratio, 0)) {
+            return NULL;
+        }
+        if (k > 0 && lambdas[k] > lambdas[k - 1]) {
+            CUSTOM_ERROR("'lambdas' must be in descending order");
+            return NULL;
+        }
+    }
+
+    Matrix *coefs = matrix_create(num_lambdas, model->number_of_features);
+    Vector *path_intercepts = intercepts ? vector_create(num_lambdas) : NULL;
+    if (!coefs || (intercepts && !path_intercepts)) {
+        ALLOCATION_ERROR();
+        if (coefs) matrix_free(coefs);
+        if (path_intercepts) vector_free(path_intercepts);
+        return NULL;
+    }
+    model->lambda = lambdas[num_lambdas - 1];
+    model->ratio = ratio;
+    logistic_regression_coordinate_descent(model, X, y, lambdas, num_lambdas, ratio, num_iters, 0, coefs, path_intercepts);
+    if (intercepts) {
+        *intercepts = path_intercepts;
+    }
+    return coefs;
+}
+
+Vector *logistic_regression_predict_proba(LogisticRegression *model, Matrix *X) {
     if (!X) {
         NULL_ERROR("Matrix");
         return NULL;
     }
-    if (X->cols != model->number_of_features) {
+    return logistic_regression_predict_proba_view(model, matrix_view(X));
+}
+
+Vector *logistic_regression_predict_proba_view(LogisticRegression *model, const MatrixView X) {
+    if (!model) {
+        NULL_ERROR("LogisticRegression model");
+        return NULL;
+    }
+    if (!X.data) {
+        NULL_ERROR("MatrixView");
+        return NULL;
+    }
+    if (X.cols != model->number_of_features) {
         CUSTOM_ERROR("X->cols must equal number_of_features");
         return NULL;
     }
 
-    Vector *res = vector_create(X->rows);
-    if (!res) {
+    Vector *res = vector_create(X.rows);
+    double *row_buf = malloc(sizeof(double) * X.cols);
+    if (!res || !row_buf) {
         ALLOCATION_ERROR();
+        if (res) vector_free(res);
+        free(row_buf);
         return NULL;
     }
 
-    for (int i = 0; i < X->rows; i++) {
+    const double *w = model->coef->data;
+    for (int i = 0; i < X.rows; i++) {
+        const double *x = matrix_view_row(X, i, row_buf);
         double dot = 0;
-        for (int j = 0; j < X->cols; j++) {
-            dot += matrix_get(X, i, j) * vector_get(model->coef, j);
+        for (int j = 0; j < X.cols; j++) {
+            dot += x[j] * w[j];
         }
-        vector_set(res, i, model->fit_intercept == 0 ? math_sigmoid(dot) : math_sigmoid(dot+model->intercept));
+        res->data[i] = model->fit_intercept == 0 ? dot : dot + model->intercept;
     }
+    free(row_buf);
+    math_sigmoid_array(res->data, res->data, res->dim);
     return res;
 }
 
 Vector *logistic_regression_predict(LogisticRegression *model, Matrix *X) {
-    Vector *res = logistic_regression_predict_proba(model, X);
+    if (!X) {
+        NULL_ERROR("Matrix");
+        return NULL;
+    }
+    return logistic_regression_predict_view(model, matrix_view(X));
+}
+
+Vector *logistic_regression_predict_view(LogisticRegression *model, const MatrixView X) {
+    Vector *res = logistic_regression_predict_proba_view(model, X);
     if (!res) {
         ALLOCATION_ERROR();
         return NULL;
@@ -1,11 +1,22 @@
 ﻿#ifndef LOGISTIC_REGRESSION_H
 #define LOGISTIC_REGRESSION_H
 
+#include "../csv/csv.h"
+#include "../lbfgs/lbfgs.h"
 #include "../matrix/matrix.h"
 #include "../math_functions/math_functions.h"
 #include "../penalty_types/penalty_types.h"
 #include "../random/random.h"
 
+typedef enum {
+    LOGISTIC_SGD,
+    LOGISTIC_NEWTON,
+    LOGISTIC_LBFGS,
+    LOGISTIC_COORDINATE_DESCENT,
+    LOGISTIC_SGD_HOGWILD,
+    LOGISTIC_SGD_SYNC
+} LogisticSolver;
+
 typedef struct {
     Vector *coef;
     double intercept;
@@ -14,15 +25,44 @@ typedef struct {
     int fit_intercept;
     int number_of_features;
     int random_seed;
+    pcg32_random_t *rng;
     double threshold;
     Penalty penalty;
+    LogisticSolver solver;
+    double tol;
+    int lbfgs_history;
 } LogisticRegression;
 
 LogisticRegression *logistic_regression_create(int number_of_features, int fit_intercept, int random_seed, double threshold, Penalty penalty);
 void logistic_regression_free(LogisticRegression *model);
+// LOGISTIC_SGD (the default) trains on minibatches with a fixed alpha. LOGISTIC_NEWTON runs full-batch Newton (IRLS)
+// iterations with a backtracking line search and LOGISTIC_LBFGS full-batch L-BFGS iterations keeping lbfgs_history
+// pairs (LBFGS_DEFAULT_HISTORY unless changed), both ignore batch and alpha and support NO_PENALTY and L2_RIDGE only.
+// LOGISTIC_COORDINATE_DESCENT supports every penalty and gives exact zeros, see logistic_regression_path.
+// With tol > 0 SGD stops once the epoch loss changes by at most tol relative to the previous epoch, Newton once the
+// predicted decrease of the loss is at most tol, L-BFGS as lbfgs_minimize does and coordinate descent once the
+// objective decreases by at most tol relative to its value; with tol = 0 (the default) SGD runs all num_iters and
+// the others run until a step stops improving the loss. LOGISTIC_SGD_HOGWILD and LOGISTIC_SGD_SYNC spread SGD over
+// the global thread pool as SGD_MINIBATCH_HOGWILD and SGD_MINIBATCH_SYNC do for SGD regression
+void logistic_regression_set_solver(LogisticRegression *model, LogisticSolver solver, double tol);
+// Draws the initial coefficients and the shuffles from rng, a caller-owned generator that advances across fits,
+// instead of a generator seeded with random_seed at every fit. NULL goes back to random_seed
+void logistic_regression_set_rng(LogisticRegression *model, pcg32_random_t *rng);
 
 void logistic_regression_fit(LogisticRegression *model, Matrix *X, Vector *y, int batch, double alpha, int num_iters, double lambda, double ratio, int print_every);
+void logistic_regression_fit_view(LogisticRegression *model, MatrixView X, VectorView y, int batch, double alpha, int num_iters, double lambda, double ratio, int print_every);
+// Trains from a stream whose rows are the features followed by the 0/1 target, rewinding it every epoch.
+// Batches follow file order, there is no shuffling
+void logistic_regression_fit_stream(LogisticRegression *model, CsvStream *stream, int batch, double alpha, int num_iters, double lambda, double ratio, int print_every);
+// Proximal Newton over a descending lambda grid: every iteration approximates the loss by weighted least squares at
+// the current coefficients (one pass over the data), solves the penalized problem by coordinate descent and
+// backtracks until the objective decreases. Each lambda warm-starts the next and runs at most num_iters iterations.
+// ratio follows the penalty as in the fit functions. Returns the num_lambdas x number_of_features coefficients,
+// intercepts (may be NULL) receives one intercept per lambda and the model is left fitted at the last lambda
+Matrix *logistic_regression_path(LogisticRegression *model, MatrixView X, VectorView y, const double *lambdas, int num_lambdas, double ratio, int num_iters, Vector **intercepts);
 Vector *logistic_regression_predict_proba(LogisticRegression *model, Matrix *X);
+Vector *logistic_regression_predict_proba_view(LogisticRegression *model, MatrixView X);
 Vector *logistic_regression_predict(LogisticRegression *model, Matrix *X);
+Vector *logistic_regression_predict_view(LogisticRegression *model, MatrixView X);
 
 #endif
\ No newline at end of file
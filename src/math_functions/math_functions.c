@@ -1,6 +1,12 @@
 ﻿#include "math_functions.h"
 
 #include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
 
 double math_sign(const double x) {
     if (x < 0) {
@@ -54,13 +60,290 @@ double math_derivative_leaky_relu(const double x) {
 }
 
 double math_derivative_silu(const double x) {
-    return math_sigmoid(x) + x * math_derivative_sigmoid(x);
+    const double s = math_sigmoid(x);
+    return s + x * (s * (1 - s));
 }
 
 double math_derivative_sigmoid(const double x) {
-    return math_sigmoid(x) * (1 - math_sigmoid(x));
+    return math_derivative_sigmoid_from_output(math_sigmoid(x));
 }
 
 double math_derivative_tanh(const double x) {
-    return 1 - pow(math_tanh(x), 2);
+    return math_derivative_tanh_from_output(math_tanh(x));
+}
+
+double math_derivative_relu_from_output(const double a) {
+    return a > 0 ? 1 : 0;
+}
+
+double math_derivative_leaky_relu_from_output(const double a) {
+    return a > 0 ? 1 : 0.01;
+}
+
+double math_derivative_sigmoid_from_output(const double a) {
+    return a * (1 - a);
+}
+
+double math_derivative_tanh_from_output(const double a) {
+    return 1 - a * a;
 }
+
+// Array kernels. One implementation is written against the small vector layer below, which maps to
+// AVX-512, AVX2, SSE2 or plain scalars depending on what the compiler targets (see CLEARN_NATIVE_ARCH).
+#if defined(__AVX512F__)
+
+#define MATH_VEC_WIDTH 8
+typedef __m512d vec_t;
+typedef __mmask8 vec_mask_t;
+
+static inline vec_t vec_load(const double *p) { return _mm512_loadu_pd(p); }
+static inline void vec_store(double *p, const vec_t v) { _mm512_storeu_pd(p, v); }
+static inline vec_t vec_set(const double x) { return _mm512_set1_pd(x); }
+static inline vec_t vec_add(const vec_t a, const vec_t b) { return _mm512_add_pd(a, b); }
+static inline vec_t vec_sub(const vec_t a, const vec_t b) { return _mm512_sub_pd(a, b); }
+static inline vec_t vec_mul(const vec_t a, const vec_t b) { return _mm512_mul_pd(a, b); }
+static inline vec_t vec_div(const vec_t a, const vec_t b) { return _mm512_div_pd(a, b); }
+static inline vec_t vec_fma(const vec_t a, const vec_t b, const vec_t c) { return _mm512_fmadd_pd(a, b, c); }
+static inline vec_t vec_max(const vec_t a, const vec_t b) { return _mm512_max_pd(a, b); }
+static inline vec_t vec_min(const vec_t a, const vec_t b) { return _mm512_min_pd(a, b); }
+static inline vec_mask_t vec_gt(const vec_t a, const vec_t b) { return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ); }
+static inline vec_mask_t vec_lt(const vec_t a, const vec_t b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+static inline vec_t vec_select(const vec_mask_t m, const vec_t a, const vec_t b) { return _mm512_mask_blend_pd(m, b, a); }
+static inline vec_t vec_abs(const vec_t a) {
+    return _mm512_castsi512_pd(_mm512_and_si512(_mm512_castpd_si512(a), _mm512_set1_epi64(0x7FFFFFFFFFFFFFFFLL)));
+}
+static inline vec_t vec_copysign(const vec_t magnitude, const vec_t sign) {
+    const __m512i sign_bit = _mm512_and_si512(_mm512_castpd_si512(sign), _mm512_set1_epi64((long long)0x8000000000000000ULL));
+    return _mm512_castsi512_pd(_mm512_or_si512(_mm512_castpd_si512(magnitude), sign_bit));
+}
+// t holds n + 1.5 * 2^52, returns 2^(n - 1)
+static inline vec_t vec_pow2_from_magic(const vec_t t) {
+    const __m512i bits = _mm512_sub_epi64(_mm512_castpd_si512(t), _mm512_castpd_si512(_mm512_set1_pd(0x1.8p52)));
+    return _mm512_castsi512_pd(_mm512_slli_epi64(_mm512_add_epi64(bits, _mm512_set1_epi64(1022)), 52));
+}
+
+#elif defined(__AVX2__)
+
+#define MATH_VEC_WIDTH 4
+typedef __m256d vec_t;
+typedef __m256d vec_mask_t;
+
+static inline vec_t vec_load(const double *p) { return _mm256_loadu_pd(p); }
+static inline void vec_store(double *p, const vec_t v) { _mm256_storeu_pd(p, v); }
+static inline vec_t vec_set(const double x) { return _mm256_set1_pd(x); }
+static inline vec_t vec_add(const vec_t a, const vec_t b) { return _mm256_add_pd(a, b); }
+static inline vec_t vec_sub(const vec_t a, const vec_t b) { return _mm256_sub_pd(a, b); }
+static inline vec_t vec_mul(const vec_t a, const vec_t b) { return _mm256_mul_pd(a, b); }
+static inline vec_t vec_div(const vec_t a, const vec_t b) { return _mm256_div_pd(a, b); }
+#if defined(__FMA__)
+static inline vec_t vec_fma(const vec_t a, const vec_t b, const vec_t c) { return _mm256_fmadd_pd(a, b, c); }
+#else
+static inline vec_t vec_fma(const vec_t a, const vec_t b, const vec_t c) { return _mm256_add_pd(_mm256_mul_pd(a, b), c); }
+#endif
+static inline vec_t vec_max(const vec_t a, const vec_t b) { return _mm256_max_pd(a, b); }
+static inline vec_t vec_min(const vec_t a, const vec_t b) { return _mm256_min_pd(a, b); }
+static inline vec_mask_t vec_gt(const vec_t a, const vec_t b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+static inline vec_mask_t vec_lt(const vec_t a, const vec_t b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+static inline vec_t vec_select(const vec_mask_t m, const vec_t a, const vec_t b) { return _mm256_blendv_pd(b, a, m); }
+static inline vec_t vec_abs(const vec_t a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+static inline vec_t vec_copysign(const vec_t magnitude, const vec_t sign) {
+    return _mm256_or_pd(magnitude, _mm256_and_pd(sign, _mm256_set1_pd(-0.0)));
+}
+static inline vec_t vec_pow2_from_magic(const vec_t t) {
+    const __m256i bits = _mm256_sub_epi64(_mm256_castpd_si256(t), _mm256_castpd_si256(_mm256_set1_pd(0x1.8p52)));
+    return _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(bits, _mm256_set1_epi64x(1022)), 52));
+}
+
+#elif defined(__SSE2__)
+
+#define MATH_VEC_WIDTH 2
+typedef __m128d vec_t;
+typedef __m128d vec_mask_t;
+
+static inline vec_t vec_load(const double *p) { return _mm_loadu_pd(p); }
+static inline void vec_store(double *p, const vec_t v) { _mm_storeu_pd(p, v); }
+static inline vec_t vec_set(const double x) { return _mm_set1_pd(x); }
+static inline vec_t vec_add(const vec_t a, const vec_t b) { return _mm_add_pd(a, b); }
+static inline vec_t vec_sub(const vec_t a, const vec_t b) { return _mm_sub_pd(a, b); }
+static inline vec_t vec_mul(const vec_t a, const vec_t b) { return _mm_mul_pd(a, b); }
+static inline vec_t vec_div(const vec_t a, const vec_t b) { return _mm_div_pd(a, b); }
+static inline vec_t vec_fma(const vec_t a, const vec_t b, const vec_t c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+static inline vec_t vec_max(const vec_t a, const vec_t b) { return _mm_max_pd(a, b); }
+static inline vec_t vec_min(const vec_t a, const vec_t b) { return _mm_min_pd(a, b); }
+static inline vec_mask_t vec_gt(const vec_t a, const vec_t b) { return _mm_cmpgt_pd(a, b); }
+static inline vec_mask_t vec_lt(const vec_t a, const vec_t b) { return _mm_cmplt_pd(a, b); }
+static inline vec_t vec_select(const vec_mask_t m, const vec_t a, const vec_t b) { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+static inline vec_t vec_abs(const vec_t a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+static inline vec_t vec_copysign(const vec_t magnitude, const vec_t sign) {
+    return _mm_or_pd(magnitude, _mm_and_pd(sign, _mm_set1_pd(-0.0)));
+}
+static inline vec_t vec_pow2_from_magic(const vec_t t) {
+    const __m128i bits = _mm_sub_epi64(_mm_castpd_si128(t), _mm_castpd_si128(_mm_set1_pd(0x1.8p52)));
+    return _mm_castsi128_pd(_mm_slli_epi64(_mm_add_epi64(bits, _mm_set1_epi64x(1022)), 52));
+}
+
+#else
+
+#define MATH_VEC_WIDTH 1
+typedef double vec_t;
+typedef int vec_mask_t;
+
+static inline vec_t vec_load(const double *p) { return *p; }
+static inline void vec_store(double *p, const vec_t v) { *p = v; }
+static inline vec_t vec_set(const double x) { return x; }
+static inline vec_t vec_add(const vec_t a, const vec_t b) { return a + b; }
+static inline vec_t vec_sub(const vec_t a, const vec_t b) { return a - b; }
+static inline vec_t vec_mul(const vec_t a, const vec_t b) { return a * b; }
+static inline vec_t vec_div(const vec_t a, const vec_t b) { return a / b; }
+static inline vec_t vec_fma(const vec_t a, const vec_t b, const vec_t c) { return a * b + c; }
+static inline vec_t vec_max(const vec_t a, const vec_t b) { return a > b ? a : b; }
+static inline vec_t vec_min(const vec_t a, const vec_t b) { return a < b ? a : b; }
+static inline vec_mask_t vec_gt(const vec_t a, const vec_t b) { return a > b; }
+static inline vec_mask_t vec_lt(const vec_t a, const vec_t b) { return a < b; }
+static inline vec_t vec_select(const vec_mask_t m, const vec_t a, const vec_t b) { return m ? a : b; }
+static inline vec_t vec_abs(const vec_t a) { return fabs(a); }
+static inline vec_t vec_copysign(const vec_t magnitude, const vec_t sign) { return copysign(magnitude, sign); }
+static inline vec_t vec_pow2_from_magic(const vec_t t) {
+    uint64_t bits, magic_bits;
+    const double magic = 0x1.8p52;
+    memcpy(&bits, &t, sizeof(bits));
+    memcpy(&magic_bits, &magic, sizeof(magic_bits));
+    bits = (bits - magic_bits + 1022) << 52;
+    double result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+#endif
+
+// exp(x) = 2^n * (1 + q) with q = expm1(r), |r| <= ln(2) / 2, Cody-Waite reduction and a degree 12
+// Taylor polynomial (truncation error below 2e-16). Returns 2^(n - 1), so 2^n never overflows at n = 1024.
+// Inputs must already be clamped to [-707, 709.79]
+static inline vec_t vec_exp_reduce(const vec_t x, vec_t *q) {
+    const vec_t magic = vec_set(0x1.8p52);
+    const vec_t t = vec_fma(x, vec_set(1.4426950408889634), magic);
+    const vec_t n = vec_sub(t, magic);
+    vec_t r = vec_fma(n, vec_set(-6.93147180369123816490e-01), x);
+    r = vec_fma(n, vec_set(-1.90821492927058770002e-10), r);
+
+    vec_t p = vec_set(1.0 / 479001600.0);
+    p = vec_fma(p, r, vec_set(1.0 / 39916800.0));
+    p = vec_fma(p, r, vec_set(1.0 / 3628800.0));
+    p = vec_fma(p, r, vec_set(1.0 / 362880.0));
+    p = vec_fma(p, r, vec_set(1.0 / 40320.0));
+    p = vec_fma(p, r, vec_set(1.0 / 5040.0));
+    p = vec_fma(p, r, vec_set(1.0 / 720.0));
+    p = vec_fma(p, r, vec_set(1.0 / 120.0));
+    p = vec_fma(p, r, vec_set(1.0 / 24.0));
+    p = vec_fma(p, r, vec_set(1.0 / 6.0));
+    p = vec_fma(p, r, vec_set(0.5));
+    p = vec_fma(p, r, vec_set(1.0));
+    *q = vec_mul(p, r);
+
+    return vec_pow2_from_magic(t);
+}
+
+static inline vec_t vec_exp(const vec_t x) {
+    const vec_t lo = vec_set(-707.0);
+    const vec_t hi = vec_set(709.782712893384);
+    // Operand order keeps NaN inputs NaN
+    const vec_t xc = vec_min(hi, vec_max(lo, x));
+    vec_t q;
+    const vec_t half_scale = vec_exp_reduce(xc, &q);
+    const vec_t result = vec_mul(vec_fma(half_scale, q, half_scale), vec_set(2.0));
+    return vec_select(vec_lt(x, lo), vec_set(0.0), vec_select(vec_gt(x, hi), vec_set(INFINITY), result));
+}
+
+static inline vec_t vec_expm1(const vec_t x) {
+    const vec_t lo = vec_set(-707.0);
+    const vec_t hi = vec_set(709.782712893384);
+    const vec_t xc = vec_min(hi, vec_max(lo, x));
+    vec_t q;
+    const vec_t scale = vec_mul(vec_exp_reduce(xc, &q), vec_set(2.0));
+    const vec_t result = vec_fma(scale, q, vec_sub(scale, vec_set(1.0)));
+    return vec_select(vec_lt(x, lo), vec_set(-1.0), vec_select(vec_gt(x, hi), vec_set(INFINITY), result));
+}
+
+static inline vec_t vec_sigmoid(const vec_t x) {
+    const vec_t one = vec_set(1.0);
+    return vec_div(one, vec_add(one, vec_exp(vec_sub(vec_set(0.0), x))));
+}
+
+static inline vec_t vec_tanh(const vec_t x) {
+    // tanh(|x|) = -expm1(-2|x|) / (2 + expm1(-2|x|)), which stays accurate near 0
+    const vec_t e = vec_expm1(vec_mul(vec_abs(x), vec_set(-2.0)));
+    const vec_t t = vec_div(vec_sub(vec_set(0.0), e), vec_add(vec_set(2.0), e));
+    return vec_copysign(t, x);
+}
+
+static inline vec_t vec_relu(const vec_t x) {
+    return vec_select(vec_gt(x, vec_set(0.0)), x, vec_set(0.0));
+}
+
+static inline vec_t vec_leaky_relu(const vec_t x) {
+    return vec_select(vec_gt(x, vec_set(0.0)), x, vec_mul(x, vec_set(0.01)));
+}
+
+static inline vec_t vec_silu(const vec_t x) {
+    return vec_mul(x, vec_sigmoid(x));
+}
+
+static inline vec_t vec_derivative_sigmoid_from_output(const vec_t a) {
+    return vec_mul(a, vec_sub(vec_set(1.0), a));
+}
+
+static inline vec_t vec_derivative_tanh_from_output(const vec_t a) {
+    return vec_sub(vec_set(1.0), vec_mul(a, a));
+}
+
+static inline vec_t vec_derivative_relu(const vec_t x) {
+    return vec_select(vec_gt(x, vec_set(0.0)), vec_set(1.0), vec_set(0.0));
+}
+
+static inline vec_t vec_derivative_leaky_relu(const vec_t x) {
+    return vec_select(vec_gt(x, vec_set(0.0)), vec_set(1.0), vec_set(0.01));
+}
+
+static inline vec_t vec_derivative_sigmoid(const vec_t x) {
+    return vec_derivative_sigmoid_from_output(vec_sigmoid(x));
+}
+
+static inline vec_t vec_derivative_silu(const vec_t x) {
+    const vec_t s = vec_sigmoid(x);
+    return vec_fma(vec_mul(x, s), vec_sub(vec_set(1.0), s), s);
+}
+
+static inline vec_t vec_derivative_tanh(const vec_t x) {
+    return vec_derivative_tanh_from_output(vec_tanh(x));
+}
+
+// The tail goes through a padded buffer so every element sees the same instruction sequence
+#define MATH_ARRAY_KERNEL(name, vec_func)                                   \
+void name(const double *in, double *out, const size_t n) {                 \
+    size_t i = 0;                                                           \
+    for (; i + MATH_VEC_WIDTH <= n; i += MATH_VEC_WIDTH) {                  \
+        vec_store(out + i, vec_func(vec_load(in + i)));                     \
+    }                                                                       \
+    if (i < n) {                                                            \
+        double buf[MATH_VEC_WIDTH] = {0};                                   \
+        memcpy(buf, in + i, sizeof(double) * (n - i));                      \
+        vec_store(buf, vec_func(vec_load(buf)));                            \
+        memcpy(out + i, buf, sizeof(double) * (n - i));                     \
+    }                                                                       \
+}
+
+MATH_ARRAY_KERNEL(math_exp_array, vec_exp)
+MATH_ARRAY_KERNEL(math_sigmoid_array, vec_sigmoid)
+MATH_ARRAY_KERNEL(math_relu_array, vec_relu)
+MATH_ARRAY_KERNEL(math_leaky_relu_array, vec_leaky_relu)
+MATH_ARRAY_KERNEL(math_silu_array, vec_silu)
+MATH_ARRAY_KERNEL(math_tanh_array, vec_tanh)
+MATH_ARRAY_KERNEL(math_derivative_relu_array, vec_derivative_relu)
+MATH_ARRAY_KERNEL(math_derivative_leaky_relu_array, vec_derivative_leaky_relu)
+MATH_ARRAY_KERNEL(math_derivative_silu_array, vec_derivative_silu)
+MATH_ARRAY_KERNEL(math_derivative_sigmoid_array, vec_derivative_sigmoid)
+MATH_ARRAY_KERNEL(math_derivative_tanh_array, vec_derivative_tanh)
+MATH_ARRAY_KERNEL(math_derivative_relu_from_output_array, vec_derivative_relu)
+MATH_ARRAY_KERNEL(math_derivative_leaky_relu_from_output_array, vec_derivative_leaky_relu)
+MATH_ARRAY_KERNEL(math_derivative_sigmoid_from_output_array, vec_derivative_sigmoid_from_output)
+MATH_ARRAY_KERNEL(math_derivative_tanh_from_output_array, vec_derivative_tanh_from_output)
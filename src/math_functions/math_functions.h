@@ -1,6 +1,8 @@
 ﻿#ifndef MATH_FUNCTIONS_H
 #define MATH_FUNCTIONS_H
 
+#include <stddef.h>
+
 double math_sign(double x);
 double math_xavier(double fan_in, double fan_out);
 double math_sigmoid(double x);
@@ -15,4 +17,31 @@ double math_derivative_silu(double x);
 double math_derivative_sigmoid(double x);
 double math_derivative_tanh(double x);
 
+// Derivatives written in terms of the activation output a = f(x), so backprop can reuse cached activations.
+// ReLU and LeakyReLU are positive exactly where x is. SiLU has no such form
+double math_derivative_relu_from_output(double a);
+double math_derivative_leaky_relu_from_output(double a);
+double math_derivative_sigmoid_from_output(double a);
+double math_derivative_tanh_from_output(double a);
+
+// Vectorised versions over n elements, in and out may alias. Within a few ulp of libm (relative error below 1e-15);
+// exp results below ~1e-307 flush to zero
+void math_exp_array(const double *in, double *out, size_t n);
+void math_sigmoid_array(const double *in, double *out, size_t n);
+void math_relu_array(const double *in, double *out, size_t n);
+void math_leaky_relu_array(const double *in, double *out, size_t n);
+void math_silu_array(const double *in, double *out, size_t n);
+void math_tanh_array(const double *in, double *out, size_t n);
+
+void math_derivative_relu_array(const double *in, double *out, size_t n);
+void math_derivative_leaky_relu_array(const double *in, double *out, size_t n);
+void math_derivative_silu_array(const double *in, double *out, size_t n);
+void math_derivative_sigmoid_array(const double *in, double *out, size_t n);
+void math_derivative_tanh_array(const double *in, double *out, size_t n);
+
+void math_derivative_relu_from_output_array(const double *in, double *out, size_t n);
+void math_derivative_leaky_relu_from_output_array(const double *in, double *out, size_t n);
+void math_derivative_sigmoid_from_output_array(const double *in, double *out, size_t n);
+void math_derivative_tanh_from_output_array(const double *in, double *out, size_t n);
+
 #endif
\ No newline at end of file
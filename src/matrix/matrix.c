@@ -1,8 +1,17 @@
 ﻿#include <math.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "matrix.h"
+#include "../csv/csv.h"
+#include "../file_mapping/file_mapping.h"
+#include "../gemm/gemm.h"
+#include "../thread_pool/thread_pool.h"
+
+// Elements per chunk before an elementwise operation is split across threads
+#define MATRIX_PARALLEL_GRAIN 32768
+#define MATRIX_APPLY_PARALLEL_GRAIN 4096
 
 Matrix *matrix_create(const int rows, const int cols) {
     if (rows < 1 || cols < 1) {
@@ -17,6 +26,7 @@ Matrix *matrix_create(const int rows, const int cols) {
 
     X->rows = rows;
     X->cols = cols;
+    X->mapping = NULL;
     X->data = calloc(rows * cols, sizeof(double));
     if (!X->data) {
         ALLOCATION_ERROR();
@@ -38,20 +48,50 @@ Matrix *matrix_copy(const Matrix *X) {
         ALLOCATION_ERROR();
         return NULL;
     }
-    memcpy(copy->data, X->data, sizeof(double) * X->rows * X->cols);
+    matrix_copy_into(copy, X);
 
     return copy;
 }
 
+static int matrix_check_destination(const Matrix *dst, const int rows, const int cols) {
+    if (!dst) {
+        NULL_ERROR("Destination matrix");
+        return 0;
+    }
+    if (dst->rows != rows || dst->cols != cols) {
+        CUSTOM_ERROR("Destination matrix must be (%d, %d), got (%d, %d)", rows, cols, dst->rows, dst->cols);
+        return 0;
+    }
+    return 1;
+}
+
+void matrix_copy_into(Matrix *dst, const Matrix *X) {
+    if (!X) {
+        NULL_ERROR("Matrix");
+        return;
+    }
+    if (!matrix_check_destination(dst, X->rows, X->cols)) {
+        return;
+    }
+    if (dst->data != X->data) {
+        memcpy(dst->data, X->data, sizeof(double) * X->rows * X->cols);
+    }
+}
+
 void matrix_free(Matrix *X) {
     if (X) {
-        free(X->data);
+        if (X->mapping) {
+            file_mapping_close(X->mapping);
+        } else {
+            free(X->data);
+        }
         free(X);
     } else {
         NULL_ERROR("Matrix");
     }
 }
 
+#ifdef CLEARN_CHECKED_ACCESS
 double matrix_get(const Matrix *X, const int i, const int j) {
     if (!X) {
         NULL_ERROR("Matrix");
@@ -75,123 +115,97 @@ void matrix_set(Matrix *X, const int i, const int j, const double value) {
     }
     X->data[i * X->cols + j] = value;
 }
+#endif
 
-static int read_line(char **buf, size_t *cap, FILE *fp) {
-    size_t len = 0;
-    if (*buf == NULL) {
-        *cap = 1024;
-        *buf = malloc(*cap);
-        if (!*buf) return -1;
-    }
-    while (1) {
-        if (fgets(*buf + len, (int)(*cap - len), fp) == NULL)
-            return len > 0 ? (int)len : -1;
-        len += strlen(*buf + len);
-        if (len > 0 && (*buf)[len - 1] == '\n')
-            return (int)len;
-        if (feof(fp))
-            return (int)len;
-        *cap *= 2;
-        char *tmp = realloc(*buf, *cap);
-        if (!tmp) return -1;
-        *buf = tmp;
+MatrixView matrix_view(const Matrix *X) {
+    if (!X) {
+        NULL_ERROR("Matrix");
+        return (MatrixView){NULL, 0, 0, 0, 0};
     }
+    return (MatrixView){X->data, X->rows, X->cols, (size_t)X->cols, 1};
 }
 
-Matrix *read_csv(const char *path, const char separator, const int has_header) {
-    if (has_header < 0 || has_header > 1) {
-        CUSTOM_ERROR("Property 'has_header' must be 0 or 1");
-        return NULL;
-    }
-    FILE *file = fopen(path, "r");
-    if (!file) {
-        CUSTOM_ERROR("File %s not found", path);
-        return NULL;
+MatrixView matrix_view_subview(const MatrixView X, const int i_start, const int i_end, const int j_start, const int j_end) {
+    if (!X.data) {
+        NULL_ERROR("MatrixView");
+        return X;
     }
+    if (i_start < 0 || i_end > X.rows || i_start >= i_end || j_start < 0 || j_end > X.cols || j_start >= j_end) {
+        INDEX_ERROR();
+        return (MatrixView){NULL, 0, 0, 0, 0};
+    }
+    return (MatrixView){
+        X.data + (size_t)i_start * X.row_stride + (size_t)j_start * X.col_stride,
+        i_end - i_start,
+        j_end - j_start,
+        X.row_stride,
+        X.col_stride
+    };
+}
 
-    char *line = NULL;
-    size_t line_cap = 0;
+MatrixView matrix_view_slice(const Matrix *X, const int i_start, const int i_end, const int j_start, const int j_end) {
+    if (!X) {
+        NULL_ERROR("Matrix");
+        return (MatrixView){NULL, 0, 0, 0, 0};
+    }
+    return matrix_view_subview(matrix_view(X), i_start, i_end, j_start, j_end);
+}
 
-    const int c1 = fgetc(file);
-    const int c2 = fgetc(file);
-    const int c3 = fgetc(file);
-    if (!(c1 == 0xEF && c2 == 0xBB && c3 == 0xBF)) {
-        rewind(file);
+MatrixView matrix_view_rows(const Matrix *X, const int start, const int end) {
+    if (!X) {
+        NULL_ERROR("Matrix");
+        return (MatrixView){NULL, 0, 0, 0, 0};
     }
+    return matrix_view_subview(matrix_view(X), start, end, 0, X->cols);
+}
 
-    if (has_header == 1) {
-        read_line(&line, &line_cap, file);
+MatrixView matrix_view_cols(const Matrix *X, const int start, const int end) {
+    if (!X) {
+        NULL_ERROR("Matrix");
+        return (MatrixView){NULL, 0, 0, 0, 0};
     }
+    return matrix_view_subview(matrix_view(X), 0, X->rows, start, end);
+}
 
-    int rows = 0;
-    int cols = 0;
+MatrixView matrix_view_transpose(const MatrixView X) {
+    return (MatrixView){X.data, X.cols, X.rows, X.col_stride, X.row_stride};
+}
 
-    while(read_line(&line, &line_cap, file) != -1) {
-        if (rows == 0) {
-            cols = 1;
-            for (int i = 0; line[i] != '\0' && line[i] != '\n' && line[i] != '\r'; i++) {
-                if (line[i] == separator) {
-                    cols++;
-                }
-            }
-        }
-        rows++;
+VectorView matrix_view_col(const MatrixView X, const int col) {
+    if (!X.data) {
+        NULL_ERROR("MatrixView");
+        return (VectorView){NULL, 0, 0};
     }
+    if (col < 0 || col >= X.cols) {
+        INDEX_ERROR();
+        return (VectorView){NULL, 0, 0};
+    }
+    return (VectorView){X.data + (size_t)col * X.col_stride, X.rows, X.row_stride};
+}
 
-    if (rows == 0 || cols == 0) {
-        CUSTOM_ERROR("Empty CSV file");
-        free(line);
-        fclose(file);
+Matrix *matrix_view_copy(const MatrixView X) {
+    if (!X.data) {
+        NULL_ERROR("MatrixView");
         return NULL;
     }
 
-    Matrix *X = matrix_create(rows, cols);
-    if (!X) {
+    Matrix *copy = matrix_create(X.rows, X.cols);
+    if (!copy) {
         ALLOCATION_ERROR();
-        free(line);
-        fclose(file);
         return NULL;
     }
-
-    rewind(file);
-    {
-        const int b1 = fgetc(file);
-        const int b2 = fgetc(file);
-        const int b3 = fgetc(file);
-        if (!(b1 == 0xEF && b2 == 0xBB && b3 == 0xBF)) {
-            rewind(file);
-        }
-    }
-    if (has_header == 1) {
-        read_line(&line, &line_cap, file);
-    }
-
-    int i = 0;
-    while(read_line(&line, &line_cap, file) != -1 && i < rows) {
-        int j = 0;
-        const char sep[2] = {separator, '\0'};
-        char *saveptr;
-        const char *token = strtok_r(line, sep, &saveptr);
-        while(token && j < cols) {
-            char *endptr;
-            errno = 0;
-            double val = strtod(token, &endptr);
-
-            if (errno != 0 || endptr == token) {
-                CUSTOM_WARNING("Invalid element at [%d,%d], set to 0", i, j);
-                val = 0;
-            }
-
-            X->data[i * X->cols + j] = val;
-            token = strtok_r(NULL, sep, &saveptr);
-            j++;
+    for (int i = 0; i < X.rows; i++) {
+        double *dst = copy->data + (size_t)i * X.cols;
+        const double *row = matrix_view_row(X, i, dst);
+        if (row != dst) {
+            memcpy(dst, row, sizeof(double) * X.cols);
         }
-        i++;
     }
+    return copy;
+}
 
-    free(line);
-    fclose(file);
-    return X;
+Matrix *read_csv(const char *path, const char separator, const int has_header) {
+    return csv_read(path, separator, has_header);
 }
 
 void matrix_print(const Matrix *X) {
@@ -306,12 +320,7 @@ Matrix *matrix_transpose(Matrix *X, const int inplace) {
         ALLOCATION_ERROR();
         return NULL;
     }
-
-    for (int i = 0; i < X->rows; i++) {
-        for (int j = 0; j < X->cols; j++) {
-            transposed_matrix->data[j * transposed_matrix->cols + i] =X->data[i * X->cols + j];
-        }
-    }
+    matrix_transpose_into(transposed_matrix, X);
 
     if (inplace == 1) {
         matrix_free(X);
@@ -320,6 +329,26 @@ Matrix *matrix_transpose(Matrix *X, const int inplace) {
     return transposed_matrix;
 }
 
+void matrix_transpose_into(Matrix *dst, const Matrix *X) {
+    if (!X) {
+        NULL_ERROR("Matrix");
+        return;
+    }
+    if (!matrix_check_destination(dst, X->cols, X->rows)) {
+        return;
+    }
+    if (dst->data == X->data) {
+        CUSTOM_ERROR("Destination matrix must not alias the source");
+        return;
+    }
+
+    for (int i = 0; i < X->rows; i++) {
+        for (int j = 0; j < X->cols; j++) {
+            dst->data[j * dst->cols + i] = X->data[i * X->cols + j];
+        }
+    }
+}
+
 Matrix *matrix_inverse(Matrix *X, const int inplace) {
     if (!X) {
         NULL_ERROR("Matrix");
@@ -426,20 +455,39 @@ Matrix *matrix_slice(const Matrix *X, const int i_start, const int i_end, const
         return NULL;
     }
 
-    const int rows = i_end - i_start;
-    const int cols = j_end - j_start;
-    Matrix* slice = matrix_create(rows, cols);
+    Matrix* slice = matrix_create(i_end - i_start, j_end - j_start);
     if (!slice) {
         ALLOCATION_ERROR();
         return NULL;
     }
+    matrix_slice_into(slice, X, i_start, i_end, j_start, j_end);
+
+    return slice;
+}
+
+void matrix_slice_into(Matrix *dst, const Matrix *X, const int i_start, const int i_end, const int j_start, const int j_end) {
+    if (!X) {
+        NULL_ERROR("Matrix");
+        return;
+    }
+    if (i_start < 0 || i_end < 0 || i_start >= X->rows || i_end > X->rows || i_start >= i_end) {
+        INDEX_ERROR();
+        return;
+    }
+    if (j_start < 0 || j_end < 0 || j_start >= X->cols || j_end > X->cols || j_start >= j_end) {
+        INDEX_ERROR();
+        return;
+    }
+
+    const int rows = i_end - i_start;
+    const int cols = j_end - j_start;
+    if (!matrix_check_destination(dst, rows, cols)) {
+        return;
+    }
 
     for (int i = 0; i < rows; i++) {
-        for (int j = 0; j < cols; j++) {
-            slice->data[i * slice->cols + j] = X->data[(i_start + i) * X->cols + (j_start + j)];
-        }
+        memmove(dst->data + i * cols, X->data + (i_start + i) * X->cols + j_start, sizeof(double) * cols);
     }
-    return slice;
 }
 
 Matrix *matrix_slice_rows(const Matrix *X, const int start, const int end) {
@@ -452,19 +500,32 @@ Matrix *matrix_slice_rows(const Matrix *X, const int start, const int end) {
         return NULL;
     }
 
-    const int rows = end - start;
-    Matrix* slice = matrix_create(rows, X->cols);
+    Matrix* slice = matrix_create(end - start, X->cols);
     if (!slice) {
         ALLOCATION_ERROR();
         return NULL;
     }
+    matrix_slice_rows_into(slice, X, start, end);
 
-    for (int i = 0; i < rows; i++) {
-        memcpy(slice->data + i * X->cols, X->data + (start + i) * X->cols, sizeof(double) * X->cols);
-    }
     return slice;
 }
 
+void matrix_slice_rows_into(Matrix *dst, const Matrix *X, const int start, const int end) {
+    if (!X) {
+        NULL_ERROR("Matrix");
+        return;
+    }
+    if (start < 0 || end < 0 || start >= X->rows || end > X->rows || start >= end) {
+        INDEX_ERROR();
+        return;
+    }
+    if (!matrix_check_destination(dst, end - start, X->cols)) {
+        return;
+    }
+
+    memmove(dst->data, X->data + start * X->cols, sizeof(double) * (end - start) * X->cols);
+}
+
 Matrix *matrix_slice_cols(const Matrix *X, const int start, const int end) {
     if (!X) {
         NULL_ERROR("Matrix");
@@ -475,19 +536,34 @@ Matrix *matrix_slice_cols(const Matrix *X, const int start, const int end) {
         return NULL;
     }
 
-    const int cols = end - start;
-    Matrix* slice = matrix_create(X->rows, cols);
+    Matrix* slice = matrix_create(X->rows, end - start);
     if (!slice) {
         ALLOCATION_ERROR();
         return NULL;
     }
+    matrix_slice_cols_into(slice, X, start, end);
+
+    return slice;
+}
+
+void matrix_slice_cols_into(Matrix *dst, const Matrix *X, const int start, const int end) {
+    if (!X) {
+        NULL_ERROR("Matrix");
+        return;
+    }
+    if (start < 0 || end < 0 || start >= X->cols || end > X->cols || start >= end) {
+        INDEX_ERROR();
+        return;
+    }
+
+    const int cols = end - start;
+    if (!matrix_check_destination(dst, X->rows, cols)) {
+        return;
+    }
 
     for (int i = 0; i < X->rows; i++) {
-        for (int j = 0; j < cols; j++) {
-            slice->data[i * cols + j] = X->data[i * X->cols + start + j];
-        }
+        memmove(dst->data + i * cols, X->data + i * X->cols + start, sizeof(double) * cols);
     }
-    return slice;
 }
 
 Matrix *matrix_concat(const Matrix *A, const Matrix *B) {
@@ -500,70 +576,128 @@ Matrix *matrix_concat(const Matrix *A, const Matrix *B) {
         return NULL;
     }
 
-    const int cols = A->cols + B->cols;
-    Matrix* C = matrix_create(A->rows, cols);
+    Matrix* C = matrix_create(A->rows, A->cols + B->cols);
     if (!C) {
         ALLOCATION_ERROR();
         return NULL;
     }
-
-    for (int i = 0; i < A->rows; i++) {
-        memcpy(C->data + i * cols, A->data + i * A->cols, sizeof(double) * A->cols);
-        memcpy(C->data + i * cols + A->cols, B->data + i * B->cols, sizeof(double) * B->cols);
-    }
+    matrix_concat_into(C, A, B);
 
     return C;
 }
 
-Matrix *matrix_arithmetic(const Matrix *A, const Matrix *B, const char op) {
+void matrix_concat_into(Matrix *C, const Matrix *A, const Matrix *B) {
     if (!A || !B) {
         NULL_ERROR("Matrix");
-        return NULL;
+        return;
     }
-    if (A->cols != B->cols || A->rows != B->rows) {
-        CUSTOM_ERROR("Matrix dimensions must match");
-        return NULL;
+    if (A->rows != B->rows) {
+        CUSTOM_ERROR("Matrix row dimensions must match");
+        return;
     }
 
-    Matrix* C = matrix_create(A->rows, A->cols);
-    if (!C) {
-        ALLOCATION_ERROR();
-        return NULL;
+    const int cols = A->cols + B->cols;
+    if (!matrix_check_destination(C, A->rows, cols)) {
+        return;
+    }
+    if (C->data == A->data || C->data == B->data) {
+        CUSTOM_ERROR("Destination matrix must not alias an operand");
+        return;
     }
 
-    const int size = A->rows * A->cols;
-    switch (op) {
+    for (int i = 0; i < A->rows; i++) {
+        memcpy(C->data + i * cols, A->data + i * A->cols, sizeof(double) * A->cols);
+        memcpy(C->data + i * cols + A->cols, B->data + i * B->cols, sizeof(double) * B->cols);
+    }
+}
+
+typedef struct {
+    const double *a;
+    const double *b;
+    double *c;
+    int cols;
+    char op;
+} ArithmeticTask;
+
+static void matrix_arithmetic_range(void *ctx, const int start, const int end) {
+    const ArithmeticTask *t = ctx;
+    const double *a = t->a;
+    const double *b = t->b;
+    double *c = t->c;
+
+    switch (t->op) {
         case '+':
-            for (int i = 0; i < size; i++)
-                C->data[i] = A->data[i] + B->data[i];
+            for (int i = start; i < end; i++)
+                c[i] = a[i] + b[i];
             break;
         case '-':
-            for (int i = 0; i < size; i++)
-                C->data[i] = A->data[i] - B->data[i];
+            for (int i = start; i < end; i++)
+                c[i] = a[i] - b[i];
             break;
         case '*':
-            for (int i = 0; i < size; i++)
-                C->data[i] = A->data[i] * B->data[i];
+            for (int i = start; i < end; i++)
+                c[i] = a[i] * b[i];
             break;
         case '/':
-            for (int i = 0; i < size; i++) {
-                if (B->data[i] == 0) {
-                    CUSTOM_WARNING("Division by zero detected at [%d,%d], set to 0", i / A->cols, i % A->cols);
-                    C->data[i] = 0;
+            for (int i = start; i < end; i++) {
+                if (b[i] == 0) {
+                    CUSTOM_WARNING("Division by zero detected at [%d,%d], set to 0", i / t->cols, i % t->cols);
+                    c[i] = 0;
                 } else {
-                    C->data[i] = A->data[i] / B->data[i];
+                    c[i] = a[i] / b[i];
                 }
             }
             break;
         default:
-            CUSTOM_ERROR("Invalid operator");
-            matrix_free(C);
-            return NULL;
+            break;
+    }
+}
+
+Matrix *matrix_arithmetic(const Matrix *A, const Matrix *B, const char op) {
+    if (!A || !B) {
+        NULL_ERROR("Matrix");
+        return NULL;
     }
+    if (A->cols != B->cols || A->rows != B->rows) {
+        CUSTOM_ERROR("Matrix dimensions must match");
+        return NULL;
+    }
+    if (op != '+' && op != '-' && op != '*' && op != '/') {
+        CUSTOM_ERROR("Invalid operator");
+        return NULL;
+    }
+
+    Matrix* C = matrix_create(A->rows, A->cols);
+    if (!C) {
+        ALLOCATION_ERROR();
+        return NULL;
+    }
+    matrix_arithmetic_into(C, A, B, op);
+
     return C;
 }
 
-// TODO: try faster multiply (strassen? winograd)
+void matrix_arithmetic_into(Matrix *C, const Matrix *A, const Matrix *B, const char op) {
+    if (!A || !B) {
+        NULL_ERROR("Matrix");
+        return;
+    }
+    if (A->cols != B->cols || A->rows != B->rows) {
+        CUSTOM_ERROR("Matrix dimensions must match");
+        return;
+    }
+    if (op != '+' && op != '-' && op != '*' && op != '/') {
+        CUSTOM_ERROR("Invalid operator");
+        return;
+    }
+    if (!matrix_check_destination(C, A->rows, A->cols)) {
+        return;
+    }
+
+    ArithmeticTask task = {A->data, B->data, C->data, A->cols, op};
+    clearn_parallel_for(A->rows * A->cols, MATRIX_PARALLEL_GRAIN, matrix_arithmetic_range, &task);
+}
+
 Matrix *matrix_multiplication(const Matrix *A, const Matrix *B) {
     if (!A || !B) {
         NULL_ERROR("Matrix");
@@ -579,119 +713,346 @@ Matrix *matrix_multiplication(const Matrix *A, const Matrix *B) {
         ALLOCATION_ERROR();
         return NULL;
     }
+    matrix_multiplication_into(C, A, B);
 
-    const int m = A->rows;
-    const int n = A->cols;
-    const int p = B->cols;
+    return C;
+}
 
-    for (int i = 0; i < m; i++) {
-        for (int j = 0; j < p; j++) {
-            double sum = 0;
-            for (int k = 0; k < n; k++) {
-                sum += A->data[i * n + k] * B->data[k * p + j];
-            }
-            C->data[i * p + j] = sum;
-        }
+void matrix_multiplication_into(Matrix *C, const Matrix *A, const Matrix *B) {
+    if (!A || !B) {
+        NULL_ERROR("Matrix");
+        return;
     }
+    if (A->cols != B->rows) {
+        CUSTOM_ERROR("Incompatible dimensions for multiplication");
+        return;
+    }
+    if (!matrix_check_destination(C, A->rows, B->cols)) {
+        return;
+    }
+    if (C->data == A->data || C->data == B->data) {
+        CUSTOM_ERROR("Destination matrix must not alias an operand");
+        return;
+    }
+
+    gemm_multiply(0, 0, A->rows, B->cols, A->cols, A->data, A->cols, B->data, B->cols, C->data, C->cols);
+}
+
+Matrix *matrix_view_multiplication(const MatrixView A, const MatrixView B) {
+    if (!A.data || !B.data) {
+        NULL_ERROR("MatrixView");
+        return NULL;
+    }
+    if (A.cols != B.rows) {
+        CUSTOM_ERROR("Incompatible dimensions for multiplication");
+        return NULL;
+    }
+
+    Matrix *C = matrix_create(A.rows, B.cols);
+    if (!C) {
+        ALLOCATION_ERROR();
+        return NULL;
+    }
+    matrix_view_multiplication_into(C, A, B);
 
     return C;
 }
 
-void matrix_scalar_arithmetic(Matrix *X, const double scalar, const char op) {
-    if (!X) {
+static int matrix_contains(const Matrix *X, const double *p) {
+    return (uintptr_t)p >= (uintptr_t)X->data && (uintptr_t)p < (uintptr_t)(X->data + (size_t)X->rows * X->cols);
+}
+
+void matrix_view_multiplication_into(Matrix *C, const MatrixView A, const MatrixView B) {
+    if (!A.data || !B.data) {
+        NULL_ERROR("MatrixView");
+        return;
+    }
+    if (A.cols != B.rows) {
+        CUSTOM_ERROR("Incompatible dimensions for multiplication");
+        return;
+    }
+    if (!matrix_check_destination(C, A.rows, B.cols)) {
+        return;
+    }
+    if (matrix_contains(C, A.data) || matrix_contains(C, B.data)) {
+        CUSTOM_ERROR("Destination matrix must not alias an operand");
+        return;
+    }
+
+    gemm_multiply_strided(A.rows, B.cols, A.cols, A.data, A.row_stride, A.col_stride, B.data, B.row_stride, B.col_stride, C->data, C->cols, NULL);
+}
+
+Matrix *matrix_multiplication_tn(const Matrix *A, const Matrix *B) {
+    if (!A || !B) {
+        NULL_ERROR("Matrix");
+        return NULL;
+    }
+    if (A->rows != B->rows) {
+        CUSTOM_ERROR("Incompatible dimensions for multiplication");
+        return NULL;
+    }
+
+    Matrix* C = matrix_create(A->cols, B->cols);
+    if (!C) {
+        ALLOCATION_ERROR();
+        return NULL;
+    }
+    matrix_multiplication_tn_into(C, A, B);
+
+    return C;
+}
+
+void matrix_multiplication_tn_into(Matrix *C, const Matrix *A, const Matrix *B) {
+    if (!A || !B) {
         NULL_ERROR("Matrix");
         return;
     }
+    if (A->rows != B->rows) {
+        CUSTOM_ERROR("Incompatible dimensions for multiplication");
+        return;
+    }
+    if (!matrix_check_destination(C, A->cols, B->cols)) {
+        return;
+    }
+    if (C->data == A->data || C->data == B->data) {
+        CUSTOM_ERROR("Destination matrix must not alias an operand");
+        return;
+    }
+
+    gemm_multiply(1, 0, A->cols, B->cols, A->rows, A->data, A->cols, B->data, B->cols, C->data, C->cols);
+}
+
+Matrix *matrix_multiplication_nt(const Matrix *A, const Matrix *B) {
+    if (!A || !B) {
+        NULL_ERROR("Matrix");
+        return NULL;
+    }
+    if (A->cols != B->cols) {
+        CUSTOM_ERROR("Incompatible dimensions for multiplication");
+        return NULL;
+    }
+
+    Matrix* C = matrix_create(A->rows, B->rows);
+    if (!C) {
+        ALLOCATION_ERROR();
+        return NULL;
+    }
+    matrix_multiplication_nt_into(C, A, B);
+
+    return C;
+}
 
-    const int size = X->rows * X->cols;
-    switch (op) {
+void matrix_multiplication_nt_into(Matrix *C, const Matrix *A, const Matrix *B) {
+    if (!A || !B) {
+        NULL_ERROR("Matrix");
+        return;
+    }
+    if (A->cols != B->cols) {
+        CUSTOM_ERROR("Incompatible dimensions for multiplication");
+        return;
+    }
+    if (!matrix_check_destination(C, A->rows, B->rows)) {
+        return;
+    }
+    if (C->data == A->data || C->data == B->data) {
+        CUSTOM_ERROR("Destination matrix must not alias an operand");
+        return;
+    }
+
+    gemm_multiply(0, 1, A->rows, B->rows, A->cols, A->data, A->cols, B->data, B->cols, C->data, C->cols);
+}
+
+typedef struct {
+    double *x;
+    double scalar;
+    char op;
+} ScalarArithmeticTask;
+
+static void matrix_scalar_arithmetic_range(void *ctx, const int start, const int end) {
+    const ScalarArithmeticTask *t = ctx;
+    double *x = t->x;
+    const double scalar = t->scalar;
+
+    switch (t->op) {
         case '+':
-            for (int i = 0; i < size; i++)
-                X->data[i] += scalar;
+            for (int i = start; i < end; i++)
+                x[i] += scalar;
             break;
         case '-':
-            for (int i = 0; i < size; i++)
-                X->data[i] -= scalar;
+            for (int i = start; i < end; i++)
+                x[i] -= scalar;
             break;
         case '*':
-            for (int i = 0; i < size; i++)
-                X->data[i] *= scalar;
+            for (int i = start; i < end; i++)
+                x[i] *= scalar;
             break;
         case '/':
-            if (scalar == 0) {
-                CUSTOM_ERROR("Division by zero is not allowed");
-                return;
-            }
-            for (int i = 0; i < size; i++)
-                X->data[i] /= scalar;
+            for (int i = start; i < end; i++)
+                x[i] /= scalar;
             break;
         default:
-            CUSTOM_ERROR("Invalid operator");
+            break;
     }
 }
 
-double matrix_min(const Matrix *X) {
+void matrix_scalar_arithmetic(Matrix *X, const double scalar, const char op) {
     if (!X) {
         NULL_ERROR("Matrix");
+        return;
+    }
+    if (op != '+' && op != '-' && op != '*' && op != '/') {
+        CUSTOM_ERROR("Invalid operator");
+        return;
+    }
+    if (op == '/' && scalar == 0) {
+        CUSTOM_ERROR("Division by zero is not allowed");
+        return;
+    }
+
+    ScalarArithmeticTask task = {X->data, scalar, op};
+    clearn_parallel_for(X->rows * X->cols, MATRIX_PARALLEL_GRAIN, matrix_scalar_arithmetic_range, &task);
+}
+
+typedef struct {
+    MatrixView X;
+    double scalar;
+    char op;
+} ViewScalarArithmeticTask;
+
+static void matrix_view_scalar_arithmetic_range(void *ctx, const int start, const int end) {
+    const ViewScalarArithmeticTask *t = ctx;
+    const double scalar = t->scalar;
+    for (int i = start; i < end; i++) {
+        double *row = t->X.data + (size_t)i * t->X.row_stride;
+        if (t->X.col_stride == 1) {
+            ScalarArithmeticTask row_task = {row, scalar, t->op};
+            matrix_scalar_arithmetic_range(&row_task, 0, t->X.cols);
+            continue;
+        }
+        for (int j = 0; j < t->X.cols; j++) {
+            double *x = row + (size_t)j * t->X.col_stride;
+            *x = t->op == '+' ? *x + scalar : t->op == '-' ? *x - scalar : t->op == '*' ? *x * scalar : *x / scalar;
+        }
+    }
+}
+
+void matrix_view_scalar_arithmetic(const MatrixView X, const double scalar, const char op) {
+    if (!X.data) {
+        NULL_ERROR("MatrixView");
+        return;
+    }
+    if (op != '+' && op != '-' && op != '*' && op != '/') {
+        CUSTOM_ERROR("Invalid operator");
+        return;
+    }
+    if (op == '/' && scalar == 0) {
+        CUSTOM_ERROR("Division by zero is not allowed");
+        return;
+    }
+
+    ViewScalarArithmeticTask task = {X, scalar, op};
+    const int grain = MATRIX_PARALLEL_GRAIN / X.cols > 0 ? MATRIX_PARALLEL_GRAIN / X.cols : 1;
+    clearn_parallel_for(X.rows, grain, matrix_view_scalar_arithmetic_range, &task);
+}
+
+double matrix_view_min(const MatrixView X) {
+    if (!X.data) {
+        NULL_ERROR("MatrixView");
         return NAN;
     }
 
-    const int size = X->rows * X->cols;
-    double min = X->data[0];
-    for (int i = 1; i < size; i++) {
-        if (X->data[i] < min) {
-            min = X->data[i];
+    double min = X.data[0];
+    for (int i = 0; i < X.rows; i++) {
+        const double *row = X.data + (size_t)i * X.row_stride;
+        for (int j = 0; j < X.cols; j++) {
+            const double val = row[(size_t)j * X.col_stride];
+            if (val < min) min = val;
         }
     }
 
     return min;
 }
 
-double matrix_max(const Matrix *X) {
-    if (!X) {
-        NULL_ERROR("Matrix");
+double matrix_view_max(const MatrixView X) {
+    if (!X.data) {
+        NULL_ERROR("MatrixView");
         return NAN;
     }
 
-    const int size = X->rows * X->cols;
-    double max = X->data[0];
-    for (int i = 1; i < size; i++) {
-        if (X->data[i] > max) {
-            max = X->data[i];
+    double max = X.data[0];
+    for (int i = 0; i < X.rows; i++) {
+        const double *row = X.data + (size_t)i * X.row_stride;
+        for (int j = 0; j < X.cols; j++) {
+            const double val = row[(size_t)j * X.col_stride];
+            if (val > max) max = val;
         }
     }
 
     return max;
 }
 
-double matrix_sum(const Matrix *X) {
+double matrix_view_sum(const MatrixView X) {
+    if (!X.data) {
+        NULL_ERROR("MatrixView");
+        return NAN;
+    }
+
+    double sum = 0;
+    for (int i = 0; i < X.rows; i++) {
+        const double *row = X.data + (size_t)i * X.row_stride;
+        if (X.col_stride == 1) {
+            for (int j = 0; j < X.cols; j++) sum += row[j];
+        } else {
+            for (int j = 0; j < X.cols; j++) sum += row[(size_t)j * X.col_stride];
+        }
+    }
+
+    return sum;
+}
+
+double matrix_view_mean(const MatrixView X) {
+    if (!X.data) {
+        NULL_ERROR("MatrixView");
+        return NAN;
+    }
+
+    return matrix_view_sum(X) / ((double)X.rows * X.cols);
+}
+
+double matrix_min(const Matrix *X) {
     if (!X) {
         NULL_ERROR("Matrix");
         return NAN;
     }
 
-    double sum=0;
-    const int size = X->rows * X->cols;
-    for (int i = 0; i < size; i++) {
-        sum += X->data[i];
+    return matrix_view_min(matrix_view(X));
+}
+
+double matrix_max(const Matrix *X) {
+    if (!X) {
+        NULL_ERROR("Matrix");
+        return NAN;
     }
 
-    return sum;
+    return matrix_view_max(matrix_view(X));
 }
 
-double matrix_mean(const Matrix *X) {
+double matrix_sum(const Matrix *X) {
     if (!X) {
         NULL_ERROR("Matrix");
         return NAN;
     }
 
-    double sum = 0;
-    const int size = X->rows * X->cols;
-    for (int i = 0; i < size; i++) {
-        sum += X->data[i];
+    return matrix_view_sum(matrix_view(X));
+}
+
+double matrix_mean(const Matrix *X) {
+    if (!X) {
+        NULL_ERROR("Matrix");
+        return NAN;
     }
 
-    return sum / size;
+    return matrix_view_mean(matrix_view(X));
 }
 
 double matrix_row_min(const Matrix *X, const int row) {
@@ -947,6 +1308,18 @@ double matrix_col_dot_product(const Matrix *A, const int col_A, const Matrix *B,
     return sum;
 }
 
+typedef struct {
+    double *x;
+    double (*func)(double);
+} ApplyTask;
+
+static void matrix_apply_range(void *ctx, const int start, const int end) {
+    const ApplyTask *t = ctx;
+    for (int i = start; i < end; i++) {
+        t->x[i] = t->func(t->x[i]);
+    }
+}
+
 void matrix_apply(Matrix *X, double (*func)(double)) {
     if (!X) {
         NULL_ERROR("Matrix");
@@ -957,10 +1330,75 @@ void matrix_apply(Matrix *X, double (*func)(double)) {
         return;
     }
 
-    const int size = X->rows * X->cols;
-    for (int i = 0; i < size; i++) {
-        X->data[i] = func(X->data[i]);
+    ApplyTask task = {X->data, func};
+    clearn_parallel_for(X->rows * X->cols, MATRIX_APPLY_PARALLEL_GRAIN, matrix_apply_range, &task);
+}
+
+typedef struct {
+    double *x;
+    void (*func)(const double *, double *, size_t);
+} ApplyArrayTask;
+
+static void matrix_apply_array_range(void *ctx, const int start, const int end) {
+    const ApplyArrayTask *t = ctx;
+    t->func(t->x + start, t->x + start, end - start);
+}
+
+void matrix_apply_array(Matrix *X, void (*func)(const double *in, double *out, size_t n)) {
+    if (!X) {
+        NULL_ERROR("Matrix");
+        return;
     }
+    if (!func) {
+        CUSTOM_ERROR("Function pointer is NULL");
+        return;
+    }
+
+    ApplyArrayTask task = {X->data, func};
+    clearn_parallel_for(X->rows * X->cols, MATRIX_APPLY_PARALLEL_GRAIN, matrix_apply_array_range, &task);
+}
+
+typedef struct {
+    MatrixView X;
+    void (*func)(const double *, double *, size_t);
+} ViewApplyArrayTask;
+
+static void matrix_view_apply_array_range(void *ctx, const int start, const int end) {
+    const ViewApplyArrayTask *t = ctx;
+    const MatrixView X = t->X;
+    double *buf = X.col_stride == 1 ? NULL : malloc(sizeof(double) * X.cols);
+    if (X.col_stride != 1 && !buf) {
+        ALLOCATION_ERROR();
+        return;
+    }
+    for (int i = start; i < end; i++) {
+        double *row = X.data + (size_t)i * X.row_stride;
+        if (!buf) {
+            t->func(row, row, X.cols);
+            continue;
+        }
+        matrix_view_row(X, i, buf);
+        t->func(buf, buf, X.cols);
+        for (int j = 0; j < X.cols; j++) {
+            row[(size_t)j * X.col_stride] = buf[j];
+        }
+    }
+    free(buf);
+}
+
+void matrix_view_apply_array(const MatrixView X, void (*func)(const double *in, double *out, size_t n)) {
+    if (!X.data) {
+        NULL_ERROR("MatrixView");
+        return;
+    }
+    if (!func) {
+        CUSTOM_ERROR("Function pointer is NULL");
+        return;
+    }
+
+    ViewApplyArrayTask task = {X, func};
+    const int grain = MATRIX_APPLY_PARALLEL_GRAIN / X.cols > 0 ? MATRIX_APPLY_PARALLEL_GRAIN / X.cols : 1;
+    clearn_parallel_for(X.rows, grain, matrix_view_apply_array_range, &task);
 }
 
 void matrix_apply_col(Matrix *X, const int col, double (*func)(double)) {
@@ -994,12 +1432,21 @@ Matrix *vector_to_matrix(const Vector *x) {
         ALLOCATION_ERROR();
         return NULL;
     }
+    vector_to_matrix_into(X, x);
+
+    return X;
+}
 
-    for (int i = 0; i < x->dim; i++) {
-        X->data[i] = x->data[i];
+void vector_to_matrix_into(Matrix *X, const Vector *x) {
+    if (!x) {
+        NULL_ERROR("Vector");
+        return;
+    }
+    if (!matrix_check_destination(X, x->dim, 1)) {
+        return;
     }
 
-    return X;
+    memmove(X->data, x->data, sizeof(double) * x->dim);
 }
 
 Vector *matrix_to_vector(const Matrix *X, const int col, const int row_start, const int row_end) {
@@ -1021,12 +1468,36 @@ Vector *matrix_to_vector(const Matrix *X, const int col, const int row_start, co
         ALLOCATION_ERROR();
         return NULL;
     }
+    matrix_to_vector_into(x, X, col, row_start, row_end);
+
+    return x;
+}
+
+void matrix_to_vector_into(Vector *x, const Matrix *X, const int col, const int row_start, const int row_end) {
+    if (!X) {
+        NULL_ERROR("Matrix");
+        return;
+    }
+    if (!x) {
+        NULL_ERROR("Destination vector");
+        return;
+    }
+    if (col < 0 || col >= X->cols) {
+        INDEX_ERROR();
+        return;
+    }
+    if (row_start < 0 || row_end > X->rows || row_start > row_end) {
+        INDEX_ERROR();
+        return;
+    }
+    if (x->dim != row_end - row_start) {
+        CUSTOM_ERROR("Destination vector must have dimension %d, got %d", row_end - row_start, x->dim);
+        return;
+    }
 
     for (int i = 0; i < row_end - row_start; i++) {
         x->data[i] = X->data[(row_start + i) * X->cols + col];
     }
-
-    return x;
 }
 
 Matrix *matrix_one_hot(const Matrix *y, const int num_classes) {
@@ -1056,29 +1527,79 @@ Matrix *matrix_one_hot(const Matrix *y, const int num_classes) {
             matrix_free(result);
             return NULL;
         }
-        result->data[i * num_classes + label] = 1.0;
     }
+    matrix_one_hot_into(result, y, num_classes);
 
     return result;
 }
 
+void matrix_one_hot_into(Matrix *result, const Matrix *y, const int num_classes) {
+    if (!y) {
+        NULL_ERROR("Matrix");
+        return;
+    }
+    if (y->cols != 1) {
+        CUSTOM_ERROR("'y' must have exactly 1 column");
+        return;
+    }
+    if (num_classes < 2) {
+        CUSTOM_ERROR("'num_classes' must be at least 2");
+        return;
+    }
+    if (!matrix_check_destination(result, y->rows, num_classes)) {
+        return;
+    }
+
+    memset(result->data, 0, sizeof(double) * y->rows * num_classes);
+    for (int i = 0; i < y->rows; i++) {
+        const int label = (int)y->data[i];
+        if (label < 0 || label >= num_classes) {
+            CUSTOM_ERROR("Label %d out of range [0, %d)", label, num_classes);
+            return;
+        }
+        result->data[i * num_classes + label] = 1.0;
+    }
+}
+
 Matrix *matrix_shuffle_rows(Matrix *X) {
     if (!X) {
         NULL_ERROR("Matrix");
         return NULL;
     }
-    Matrix *res = matrix_copy(X);
+    Matrix *res = matrix_create(X->rows, X->cols);
     if (!res) {
         ALLOCATION_ERROR();
         return NULL;
     }
-    for (int i = res->rows - 1; i > 0; i--) {
-        const int j = (int)(pcg32_random_double() * (i + 1));
-        for (int k = 0; k < res->cols; k++) {
-            const double temp = res->data[i * res->cols + k];
-            res->data[i * res->cols + k] = res->data[j * res->cols + k];
-            res->data[j * res->cols + k] = temp;
+    matrix_shuffle_rows_into(res, X);
+    return res;
+}
+
+void matrix_shuffle_rows_into(Matrix *dst, const Matrix *X) {
+    matrix_shuffle_rows_into_r(dst, X, &pcg_state);
+}
+
+void matrix_shuffle_rows_into_r(Matrix *dst, const Matrix *X, pcg32_random_t *rng) {
+    if (!X) {
+        NULL_ERROR("Matrix");
+        return;
+    }
+    if (!rng) {
+        NULL_ERROR("Random generator");
+        return;
+    }
+    if (!matrix_check_destination(dst, X->rows, X->cols)) {
+        return;
+    }
+    if (dst->data != X->data) {
+        memcpy(dst->data, X->data, sizeof(double) * X->rows * X->cols);
+    }
+    for (int i = dst->rows - 1; i > 0; i--) {
+        const int j = (int)(pcg32_random_double_r(rng) * (i + 1));
+        for (int k = 0; k < dst->cols; k++) {
+            const double temp = dst->data[i * dst->cols + k];
+            dst->data[i * dst->cols + k] = dst->data[j * dst->cols + k];
+            dst->data[j * dst->cols + k] = temp;
         }
     }
-    return res;
 }
\ No newline at end of file
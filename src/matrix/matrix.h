@@ -10,14 +10,75 @@ typedef struct {
     int rows;
     int cols;
     double *data;
+    void *mapping; // FileMapping that data points into (matrix_load_bin), NULL when data is heap-allocated
 } Matrix;
 
 Matrix *matrix_create(int rows, int cols);
 Matrix *matrix_copy(const Matrix *X);
+void matrix_copy_into(Matrix *dst, const Matrix *X);
 void matrix_free(Matrix *X);
 
+// Bounds-checked accessors with CLEARN_CHECKED_ACCESS (on in Debug builds), plain inline loads and stores otherwise
+#ifdef CLEARN_CHECKED_ACCESS
 double matrix_get(const Matrix *X, int i, int j);
 void matrix_set(Matrix *X, int i, int j, double value);
+#else
+static inline double matrix_get(const Matrix *X, const int i, const int j) {
+    return X->data[(size_t)i * X->cols + j];
+}
+
+static inline void matrix_set(Matrix *X, const int i, const int j, const double value) {
+    X->data[(size_t)i * X->cols + j] = value;
+}
+#endif
+
+// Non-owning strided window into matrix data: element (i, j) is data[i * row_stride + j * col_stride]. Slicing,
+// column ranges and transposes are made in O(1) without copying. A view is valid only while its matrix is alive
+typedef struct {
+    double *data;
+    int rows;
+    int cols;
+    size_t row_stride;
+    size_t col_stride;
+} MatrixView;
+
+static inline double matrix_view_get(const MatrixView X, const int i, const int j) {
+    return X.data[(size_t)i * X.row_stride + (size_t)j * X.col_stride];
+}
+
+static inline void matrix_view_set(const MatrixView X, const int i, const int j, const double value) {
+    X.data[(size_t)i * X.row_stride + (size_t)j * X.col_stride] = value;
+}
+
+// Row i as a pointer into the view's data when its columns are contiguous, otherwise copied into buf (X.cols values)
+static inline const double *matrix_view_row(const MatrixView X, const int i, double *buf) {
+    const double *row = X.data + (size_t)i * X.row_stride;
+    if (X.col_stride == 1) {
+        return row;
+    }
+    for (int j = 0; j < X.cols; j++) {
+        buf[j] = row[(size_t)j * X.col_stride];
+    }
+    return buf;
+}
+
+MatrixView matrix_view(const Matrix *X);
+MatrixView matrix_view_slice(const Matrix *X, int i_start, int i_end, int j_start, int j_end);
+MatrixView matrix_view_rows(const Matrix *X, int start, int end);
+MatrixView matrix_view_cols(const Matrix *X, int start, int end);
+MatrixView matrix_view_subview(MatrixView X, int i_start, int i_end, int j_start, int j_end);
+MatrixView matrix_view_transpose(MatrixView X);
+VectorView matrix_view_col(MatrixView X, int col);
+Matrix *matrix_view_copy(MatrixView X);
+
+Matrix *matrix_view_multiplication(MatrixView A, MatrixView B);
+void matrix_view_multiplication_into(Matrix *C, MatrixView A, MatrixView B);
+void matrix_view_scalar_arithmetic(MatrixView X, double scalar, char op);
+void matrix_view_apply_array(MatrixView X, void (*func)(const double *in, double *out, size_t n));
+double matrix_view_min(MatrixView X);
+double matrix_view_max(MatrixView X);
+double matrix_view_sum(MatrixView X);
+double matrix_view_mean(MatrixView X);
 
 Matrix *read_csv(const char *path, char separator, int has_header);
 void matrix_print(const Matrix *X);
@@ -28,14 +89,25 @@ void matrix_shape(const Matrix *X);
 double matrix_size(const Matrix *X);
 
 Matrix *matrix_transpose(Matrix *X, int inplace);
+void matrix_transpose_into(Matrix *dst, const Matrix *X);
 Matrix *matrix_inverse(Matrix *X, int inplace);
 Matrix *matrix_slice(const Matrix *X, int i_start, int i_end, int j_start, int j_end);
+void matrix_slice_into(Matrix *dst, const Matrix *X, int i_start, int i_end, int j_start, int j_end);
 Matrix *matrix_slice_rows(const Matrix *X, int start, int end);
+void matrix_slice_rows_into(Matrix *dst, const Matrix *X, int start, int end);
 Matrix *matrix_slice_cols(const Matrix *X, int start, int end);
+void matrix_slice_cols_into(Matrix *dst, const Matrix *X, int start, int end);
 Matrix *matrix_concat(const Matrix *A, const Matrix *B);
+void matrix_concat_into(Matrix *C, const Matrix *A, const Matrix *B);
 
 Matrix *matrix_arithmetic(const Matrix *A, const Matrix *B, char op);
+void matrix_arithmetic_into(Matrix *C, const Matrix *A, const Matrix *B, char op);
 Matrix *matrix_multiplication(const Matrix *A, const Matrix *B);
+void matrix_multiplication_into(Matrix *C, const Matrix *A, const Matrix *B);
+Matrix *matrix_multiplication_tn(const Matrix *A, const Matrix *B);
+void matrix_multiplication_tn_into(Matrix *C, const Matrix *A, const Matrix *B);
+Matrix *matrix_multiplication_nt(const Matrix *A, const Matrix *B);
+void matrix_multiplication_nt_into(Matrix *C, const Matrix *A, const Matrix *B);
 void matrix_scalar_arithmetic(Matrix *X, double scalar, char op);
 
 double matrix_min(const Matrix *X);
@@ -56,12 +128,19 @@ double matrix_col_mean(const Matrix *X, int col);
 double matrix_col_std(const Matrix *X, int col, int ddof);
 double matrix_col_dot_product(const Matrix *A, int col_A, const Matrix *B, int col_B);
 void matrix_apply(Matrix *X, double (*func)(double));
+void matrix_apply_array(Matrix *X, void (*func)(const double *in, double *out, size_t n));
 void matrix_apply_col(Matrix *X, int col, double (*func)(double));
 
 Matrix *vector_to_matrix(const Vector *x);
+void vector_to_matrix_into(Matrix *X, const Vector *x);
 Vector *matrix_to_vector(const Matrix *X, int col, int row_start, int row_end);
+void matrix_to_vector_into(Vector *x, const Matrix *X, int col, int row_start, int row_end);
 
 Matrix *matrix_shuffle_rows(Matrix *X);
+void matrix_shuffle_rows_into(Matrix *dst, const Matrix *X);
+// Shuffles with the given generator instead of the global one
+void matrix_shuffle_rows_into_r(Matrix *dst, const Matrix *X, pcg32_random_t *rng);
 Matrix *matrix_one_hot(const Matrix *y, int num_classes);
+void matrix_one_hot_into(Matrix *result, const Matrix *y, int num_classes);
 
 #endif
\ No newline at end of file
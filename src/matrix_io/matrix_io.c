@@ -0,0 +1,399 @@
+#include "matrix_io.h"
+#include "../csv/csv.h"
+#include "../file_mapping/file_mapping.h"
+#include "../thread_pool/thread_pool.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define MATRIX_BIN_MAGIC "CLRNBIN"
+#define MATRIX_BIN_VERSION 1
+#define MATRIX_BIN_BYTE_ORDER 0x01020304u
+#define MATRIX_BIN_FLOAT64 1
+#define MATRIX_BIN_SIDECAR ".clbin"
+// Formatted text per CSV writer task before the buffers are written out
+#define MATRIX_CSV_CHUNK_BYTES (1 << 20)
+
+// Stored in native byte order, files from a machine with the other endianness are rejected by byte_order.
+// source_* describe the CSV a read_csv_cached sidecar was built from and are zero otherwise
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t dtype;
+    int32_t separator;
+    int32_t has_header;
+    uint32_t reserved;
+    int64_t rows;
+    int64_t cols;
+    uint64_t names_size;
+    uint64_t data_offset;
+    int64_t source_size;
+    int64_t source_mtime;
+} MatrixBinHeader;
+
+static int matrix_bin_write(const Matrix *X, const char *path, const char *const *column_names, const MatrixBinHeader *source) {
+    MatrixBinHeader header = {0};
+    memcpy(header.magic, MATRIX_BIN_MAGIC, sizeof(MATRIX_BIN_MAGIC));
+    header.version = MATRIX_BIN_VERSION;
+    header.byte_order = MATRIX_BIN_BYTE_ORDER;
+    header.dtype = MATRIX_BIN_FLOAT64;
+    header.rows = X->rows;
+    header.cols = X->cols;
+    if (source) {
+        header.separator = source->separator;
+        header.has_header = source->has_header;
+        header.source_size = source->source_size;
+        header.source_mtime = source->source_mtime;
+    }
+    if (column_names) {
+        for (int j = 0; j < X->cols; j++) {
+            header.names_size += strlen(column_names[j]) + 1;
+        }
+    }
+    const uint64_t used = sizeof(MatrixBinHeader) + header.names_size;
+    header.data_offset = (used + MATRIX_BIN_ALIGNMENT - 1) / MATRIX_BIN_ALIGNMENT * MATRIX_BIN_ALIGNMENT;
+
+    // Written next to the target and renamed over it, so a reader never maps a half-written file
+    const size_t path_len = strlen(path);
+    char *tmp_path = malloc(path_len + 5);
+    if (!tmp_path) {
+        ALLOCATION_ERROR();
+        return 0;
+    }
+    memcpy(tmp_path, path, path_len);
+    memcpy(tmp_path + path_len, ".tmp", 5);
+
+    FILE *file = fopen(tmp_path, "wb");
+    if (!file) {
+        free(tmp_path);
+        return 0;
+    }
+    static const char padding[MATRIX_BIN_ALIGNMENT] = {0};
+    const size_t count = (size_t)X->rows * X->cols;
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (int j = 0; ok && column_names && j < X->cols; j++) {
+        ok = fwrite(column_names[j], 1, strlen(column_names[j]) + 1, file) == strlen(column_names[j]) + 1;
+    }
+    ok = ok && fwrite(padding, 1, (size_t)(header.data_offset - used), file) == (size_t)(header.data_offset - used);
+    ok = ok && fwrite(X->data, sizeof(double), count, file) == count;
+    ok = fclose(file) == 0 && ok;
+
+#ifdef _WIN32
+    if (ok) {
+        remove(path);
+    }
+#endif
+    if (!ok || rename(tmp_path, path) != 0) {
+        remove(tmp_path);
+        ok = 0;
+    }
+    free(tmp_path);
+    return ok;
+}
+
+void matrix_save_bin(const Matrix *X, const char *path, const char *const *column_names) {
+    if (!X) {
+        NULL_ERROR("Matrix");
+        return;
+    }
+    if (!path) {
+        NULL_ERROR("Path");
+        return;
+    }
+    if (column_names) {
+        for (int j = 0; j < X->cols; j++) {
+            if (!column_names[j]) {
+                NULL_ERROR("Column name %d", j);
+                return;
+            }
+        }
+    }
+
+    if (!matrix_bin_write(X, path, column_names, NULL)) {
+        CUSTOM_ERROR("Could not write file %s", path);
+    }
+}
+
+typedef struct {
+    const double *data;
+    int rows;
+    int cols;
+    char separator;
+    int first_row;
+    int rows_per_chunk;
+    char **buffers;
+    size_t *lengths;
+} MatrixCsvWriteTask;
+
+static void matrix_csv_format_chunk(void *ctx, const int task, const int thread) {
+    const MatrixCsvWriteTask *t = ctx;
+    const int start = t->first_row + task * t->rows_per_chunk;
+    const int end = start + t->rows_per_chunk > t->rows ? t->rows : start + t->rows_per_chunk;
+    char *p = t->buffers[task];
+    for (int i = start; i < end; i++) {
+        const double *row = t->data + (size_t)i * t->cols;
+        for (int j = 0; j < t->cols; j++) {
+            p += csv_format_double(row[j], p);
+            *p++ = j + 1 < t->cols ? t->separator : '\n';
+        }
+    }
+    t->lengths[task] = (size_t)(p - t->buffers[task]);
+}
+
+// Rows are formatted in rounds of one chunk per thread, each into its own buffer, and written in order
+static void matrix_csv_write(const double *data, const int rows, const int cols, const char *path, const char separator, const char *const *column_names) {
+    if (separator == '\n' || separator == '\r' || separator == '\0') {
+        CUSTOM_ERROR("Invalid separator");
+        return;
+    }
+    const int num_buffers = clearn_get_num_threads();
+    size_t rows_per_chunk = MATRIX_CSV_CHUNK_BYTES / ((size_t)cols * CSV_DOUBLE_CHARS);
+    if (rows_per_chunk < 1) rows_per_chunk = 1;
+    if (rows_per_chunk > (size_t)rows) rows_per_chunk = (size_t)rows;
+
+    MatrixCsvWriteTask task = {data, rows, cols, separator, 0, (int)rows_per_chunk, NULL, NULL};
+    task.buffers = calloc(num_buffers, sizeof(char *));
+    task.lengths = malloc(sizeof(size_t) * num_buffers);
+    int ok = task.buffers && task.lengths;
+    for (int k = 0; ok && k < num_buffers; k++) {
+        task.buffers[k] = malloc(rows_per_chunk * cols * CSV_DOUBLE_CHARS);
+        ok = task.buffers[k] != NULL;
+    }
+    FILE *file = ok ? fopen(path, "wb") : NULL;
+    if (!ok) {
+        ALLOCATION_ERROR();
+    } else if (!file) {
+        CUSTOM_ERROR("Could not open %s for writing", path);
+        ok = 0;
+    }
+
+    for (int j = 0; ok && column_names && j < cols; j++) {
+        ok = fputs(column_names[j], file) >= 0 && fputc(j + 1 < cols ? separator : '\n', file) != EOF;
+    }
+    for (int first = 0; ok && first < rows; first += num_buffers * task.rows_per_chunk) {
+        task.first_row = first;
+        int num_tasks = (rows - first + task.rows_per_chunk - 1) / task.rows_per_chunk;
+        if (num_tasks > num_buffers) num_tasks = num_buffers;
+        thread_pool_run(clearn_thread_pool(), num_tasks, matrix_csv_format_chunk, &task);
+        for (int k = 0; ok && k < num_tasks; k++) {
+            ok = fwrite(task.buffers[k], 1, task.lengths[k], file) == task.lengths[k];
+        }
+    }
+    if (file) {
+        if (fclose(file) != 0 || !ok) {
+            CUSTOM_ERROR("Could not write file %s", path);
+        }
+    }
+
+    for (int k = 0; task.buffers && k < num_buffers; k++) {
+        free(task.buffers[k]);
+    }
+    free(task.buffers);
+    free(task.lengths);
+}
+
+void matrix_write_csv(const Matrix *X, const char *path, const char separator, const char *const *column_names) {
+    if (!X) {
+        NULL_ERROR("Matrix");
+        return;
+    }
+    if (!path) {
+        NULL_ERROR("Path");
+        return;
+    }
+    for (int j = 0; column_names && j < X->cols; j++) {
+        if (!column_names[j]) {
+            NULL_ERROR("Column name %d", j);
+            return;
+        }
+    }
+    matrix_csv_write(X->data, X->rows, X->cols, path, separator, column_names);
+}
+
+void vector_write_csv(const Vector *x, const char *path, const char *column_name) {
+    if (!x) {
+        NULL_ERROR("Vector");
+        return;
+    }
+    if (!path) {
+        NULL_ERROR("Path");
+        return;
+    }
+    matrix_csv_write(x->data, x->dim, 1, path, ',', column_name ? &column_name : NULL);
+}
+
+// Maps the file and checks that the header describes data that fits inside it. Returns NULL for anything else
+static FileMapping *matrix_bin_map(const char *path, MatrixBinHeader *header) {
+    FileMapping *mapping = file_mapping_open(path);
+    if (!mapping) {
+        return NULL;
+    }
+    if (mapping->size < sizeof(MatrixBinHeader)) {
+        file_mapping_close(mapping);
+        return NULL;
+    }
+    memcpy(header, mapping->data, sizeof(MatrixBinHeader));
+
+    int valid = memcmp(header->magic, MATRIX_BIN_MAGIC, sizeof(MATRIX_BIN_MAGIC)) == 0 &&
+                header->version == MATRIX_BIN_VERSION && header->byte_order == MATRIX_BIN_BYTE_ORDER &&
+                header->dtype == MATRIX_BIN_FLOAT64 &&
+                header->rows >= 1 && header->rows <= INT_MAX && header->cols >= 1 && header->cols <= INT_MAX &&
+                header->data_offset % MATRIX_BIN_ALIGNMENT == 0 &&
+                header->names_size <= mapping->size - sizeof(MatrixBinHeader) &&
+                header->data_offset >= sizeof(MatrixBinHeader) + header->names_size &&
+                header->data_offset <= mapping->size &&
+                (uint64_t)header->rows * (uint64_t)header->cols <= (mapping->size - header->data_offset) / sizeof(double);
+
+    if (valid && header->names_size > 0) {
+        const char *names = mapping->data + sizeof(MatrixBinHeader);
+        int64_t terminators = 0;
+        for (uint64_t i = 0; i < header->names_size; i++) {
+            terminators += names[i] == '\0';
+        }
+        valid = terminators == header->cols && names[header->names_size - 1] == '\0';
+    }
+    if (!valid) {
+        file_mapping_close(mapping);
+        return NULL;
+    }
+    return mapping;
+}
+
+static char **matrix_bin_names(const FileMapping *mapping, const MatrixBinHeader *header) {
+    if (header->names_size == 0) {
+        return NULL;
+    }
+
+    const int cols = (int)header->cols;
+    char **names = malloc(sizeof(char *) * cols + header->names_size);
+    if (!names) {
+        ALLOCATION_ERROR();
+        return NULL;
+    }
+    char *text = (char *)(names + cols);
+    memcpy(text, mapping->data + sizeof(MatrixBinHeader), header->names_size);
+    for (int j = 0; j < cols; j++) {
+        names[j] = text;
+        text += strlen(text) + 1;
+    }
+    return names;
+}
+
+static Matrix *matrix_bin_wrap(FileMapping *mapping, const MatrixBinHeader *header) {
+    Matrix *X = malloc(sizeof(Matrix));
+    if (!X) {
+        ALLOCATION_ERROR();
+        file_mapping_close(mapping);
+        return NULL;
+    }
+    X->rows = (int)header->rows;
+    X->cols = (int)header->cols;
+    X->data = (double *)(mapping->data + header->data_offset);
+    X->mapping = mapping;
+    return X;
+}
+
+Matrix *matrix_load_bin(const char *path, char ***column_names) {
+    if (!path) {
+        NULL_ERROR("Path");
+        return NULL;
+    }
+    if (column_names) {
+        *column_names = NULL;
+    }
+
+    MatrixBinHeader header;
+    FileMapping *mapping = matrix_bin_map(path, &header);
+    if (!mapping) {
+        CUSTOM_ERROR("File %s not found or not a valid matrix file", path);
+        return NULL;
+    }
+    if (column_names) {
+        *column_names = matrix_bin_names(mapping, &header);
+    }
+    return matrix_bin_wrap(mapping, &header);
+}
+
+static int matrix_bin_source_stamp(const char *path, MatrixBinHeader *source) {
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_stat64(path, &st) != 0) {
+        return 0;
+    }
+    source->source_mtime = (int64_t)st.st_mtime;
+#else
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return 0;
+    }
+#ifdef __linux__
+    source->source_mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#else
+    source->source_mtime = (int64_t)st.st_mtime;
+#endif
+#endif
+    source->source_size = (int64_t)st.st_size;
+    return 1;
+}
+
+Matrix *read_csv_cached(const char *path, const char separator, const int has_header) {
+    if (!path) {
+        NULL_ERROR("Path");
+        return NULL;
+    }
+    if (has_header < 0 || has_header > 1) {
+        CUSTOM_ERROR("Property 'has_header' must be 0 or 1");
+        return NULL;
+    }
+
+    MatrixBinHeader source = {0};
+    source.separator = separator;
+    source.has_header = has_header;
+    if (!matrix_bin_source_stamp(path, &source)) {
+        CUSTOM_ERROR("File %s not found", path);
+        return NULL;
+    }
+
+    const size_t path_len = strlen(path);
+    char *cache_path = malloc(path_len + sizeof(MATRIX_BIN_SIDECAR));
+    if (!cache_path) {
+        ALLOCATION_ERROR();
+        return NULL;
+    }
+    memcpy(cache_path, path, path_len);
+    memcpy(cache_path + path_len, MATRIX_BIN_SIDECAR, sizeof(MATRIX_BIN_SIDECAR));
+
+    MatrixBinHeader header;
+    FileMapping *mapping = matrix_bin_map(cache_path, &header);
+    if (mapping) {
+        if (header.source_size == source.source_size && header.source_mtime == source.source_mtime &&
+            header.separator == source.separator && header.has_header == source.has_header) {
+            free(cache_path);
+            return matrix_bin_wrap(mapping, &header);
+        }
+        file_mapping_close(mapping);
+    }
+
+    Matrix *X = csv_read(path, separator, has_header);
+    if (!X) {
+        free(cache_path);
+        return NULL;
+    }
+
+    int num_names = 0;
+    char **names = has_header ? csv_read_column_names(path, separator, &num_names) : NULL;
+    if (names && num_names != X->cols) {
+        free(names);
+        names = NULL;
+    }
+    if (!matrix_bin_write(X, cache_path, (const char *const *)names, &source)) {
+        CUSTOM_WARNING("Could not write cache file %s", cache_path);
+    }
+    free(names);
+    free(cache_path);
+    return X;
+}
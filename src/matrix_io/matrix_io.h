@@ -0,0 +1,27 @@
+#ifndef MATRIX_IO_H
+#define MATRIX_IO_H
+
+#include "../matrix/matrix.h"
+
+// Binary layout: fixed header (rows, cols, dtype, byte order), the column names as consecutive NUL-terminated
+// strings, then the row-major doubles starting at a 64-byte aligned offset
+#define MATRIX_BIN_ALIGNMENT 64
+
+// column_names holds X->cols strings, or is NULL to store none
+void matrix_save_bin(const Matrix *X, const char *path, const char *const *column_names);
+// Maps the file and returns a Matrix whose data points into the mapping, no copy is made. Writes to the matrix
+// stay private to the process, matrix_free unmaps it. When column_names is not NULL it receives the stored names
+// (NULL if there are none) as a single allocation released with free
+Matrix *matrix_load_bin(const char *path, char ***column_names);
+
+// Writes one line per row with the round-trip text of every value (csv_format_double), after a header
+// line when column_names is not NULL. Blocks of rows are formatted in parallel on the global thread pool
+void matrix_write_csv(const Matrix *X, const char *path, char separator, const char *const *column_names);
+// Single-column variant, column_name may be NULL for no header
+void vector_write_csv(const Vector *x, const char *path, const char *column_name);
+
+// read_csv through a binary sidecar (path + ".clbin"): the first call parses the CSV and writes the sidecar, later
+// calls map the sidecar as long as the CSV's size and modification time and the parse options are unchanged
+Matrix *read_csv_cached(const char *path, char separator, int has_header);
+
+#endif
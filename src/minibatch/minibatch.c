@@ -0,0 +1,214 @@
+#include "minibatch.h"
+#include "../thread_pool/thread_pool.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Rows below which a slice of a synchronous batch is not worth a task of its own
+#define MINIBATCH_MIN_SLICE_ROWS 32
+
+// Copies the rows listed in indices into the contiguous X_batch and their targets into y_batch
+static void minibatch_gather(const MatrixView X, const VectorView y, const double *indices, const int n, double *X_batch, double *y_batch) {
+    for (int i = 0; i < n; i++) {
+        const int row_idx = (int)indices[i];
+        double *dst = X_batch + (size_t)i * X.cols;
+        const double *src = matrix_view_row(X, row_idx, dst);
+        if (src != dst) {
+            memcpy(dst, src, sizeof(double) * X.cols);
+        }
+        y_batch[i] = vector_view_get(y, row_idx);
+    }
+}
+
+static void minibatch_buffers(const MinibatchTrainer *t, const int task, double **X_batch, double **y_batch, double **y_hats, double **grad) {
+    *X_batch = t->buffers + (size_t)task * t->buffer_size;
+    *y_batch = *X_batch + (size_t)t->task_rows * t->X.cols;
+    *y_hats = *y_batch + t->task_rows;
+    *grad = *y_hats + t->task_rows;
+}
+
+static void minibatch_sync_task(void *ctx, const int task, const int thread) {
+    MinibatchTrainer *t = ctx;
+    const int start = task * t->slice;
+    const int n = t->batch_rows - start < t->slice ? t->batch_rows - start : t->slice;
+    double *X_batch, *y_batch, *y_hats, *grad;
+    minibatch_buffers(t, task, &X_batch, &y_batch, &y_hats, &grad);
+
+    minibatch_gather(t->X, t->y, t->batch_indices + start, n, X_batch, y_batch);
+    t->losses[task] = t->model.gradient(t->model.model, X_batch, t->X.cols, y_batch, 1, n, grad, &t->intercept_grads[task], y_hats);
+}
+
+// Every batch is split into slices whose gradients are computed in parallel and summed in task order before a
+// single update, so the result only depends on the thread count and one task is plain serial SGD
+static double minibatch_sync_epoch(MinibatchTrainer *t, ThreadPool *pool) {
+    const int n_features = t->X.cols;
+    double total_loss = 0;
+    vector_shuffle_r(t->indices, t->rng);
+
+    for (int k = 0; k < t->X.rows; k += t->batch) {
+        const int n = k + t->batch > t->X.rows ? t->X.rows - k : t->batch;
+        int slice = (n + t->tasks - 1) / t->tasks;
+        if (slice < MINIBATCH_MIN_SLICE_ROWS) slice = MINIBATCH_MIN_SLICE_ROWS;
+        if (slice > n) slice = n;
+        const int tasks = (n + slice - 1) / slice;
+        t->batch_indices = t->indices->data + k;
+        t->batch_rows = n;
+        t->slice = slice;
+        thread_pool_run(tasks > 1 ? pool : NULL, tasks, minibatch_sync_task, t);
+
+        double *X_batch, *y_batch, *y_hats, *grad;
+        minibatch_buffers(t, 0, &X_batch, &y_batch, &y_hats, &grad);
+        double intercept_grad = t->intercept_grads[0];
+        total_loss += t->losses[0];
+        for (int task = 1; task < tasks; task++) {
+            const double *grad_task = grad + (size_t)task * t->buffer_size;
+            for (int j = 0; j < n_features; j++) grad[j] += grad_task[j];
+            intercept_grad += t->intercept_grads[task];
+            total_loss += t->losses[task];
+        }
+        t->model.update(t->model.model, grad, intercept_grad, n, t->alpha, t->lambda, t->ratio);
+    }
+    return total_loss;
+}
+
+// Hogwild: the task reshuffles its own shard with its own generator and updates the shared coefficients without
+// any locking. Concurrent updates may overwrite each other, which sparse-ish problems tolerate
+static void minibatch_hogwild_task(void *ctx, const int task, const int thread) {
+    MinibatchTrainer *t = ctx;
+    Vector *shard = t->shards[task];
+    double *X_batch, *y_batch, *y_hats, *grad;
+    minibatch_buffers(t, task, &X_batch, &y_batch, &y_hats, &grad);
+
+    vector_shuffle_r(shard, &t->rngs[task]);
+    double loss = 0;
+    for (int k = 0; k < shard->dim; k += t->batch) {
+        const int n = k + t->batch > shard->dim ? shard->dim - k : t->batch;
+        double intercept_grad;
+        minibatch_gather(t->X, t->y, shard->data + k, n, X_batch, y_batch);
+        loss += t->model.gradient(t->model.model, X_batch, t->X.cols, y_batch, 1, n, grad, &intercept_grad, y_hats);
+        t->model.update(t->model.model, grad, intercept_grad, n, t->alpha, t->lambda, t->ratio);
+    }
+    t->losses[task] = loss;
+}
+
+static double minibatch_hogwild_epoch(MinibatchTrainer *t, ThreadPool *pool) {
+    thread_pool_run(pool, t->tasks, minibatch_hogwild_task, t);
+    double total_loss = 0;
+    for (int task = 0; task < t->tasks; task++) {
+        total_loss += t->losses[task];
+    }
+    return total_loss;
+}
+
+void minibatch_free(MinibatchTrainer *trainer) {
+    if (!trainer) {
+        NULL_ERROR("Minibatch trainer");
+        return;
+    }
+    if (trainer->shards) {
+        for (int task = 0; task < trainer->tasks; task++) {
+            if (trainer->shards[task]) vector_free(trainer->shards[task]);
+        }
+    }
+    if (trainer->indices) vector_free(trainer->indices);
+    free(trainer->shards);
+    free(trainer->rngs);
+    free(trainer->buffers);
+    free(trainer->losses);
+    free(trainer->intercept_grads);
+    memset(trainer, 0, sizeof(MinibatchTrainer));
+}
+
+// Hogwild shuffles the rows once, splits them into one shard per task and seeds each task's generator with
+// pcg32_seed_stream_r on its own stream of one seed drawn from the fit's generator, so every shard's order is
+// reproducible and the shards' orders are not correlated
+int minibatch_init(MinibatchTrainer *trainer, const MinibatchModel model, const MinibatchSchedule schedule, pcg32_random_t *rng, const MatrixView X, const VectorView y, const int batch, const double alpha, const double lambda, const double ratio) {
+    if (!trainer || !model.model || !model.gradient || !model.update || !rng) {
+        NULL_ERROR("Minibatch trainer, model or generator");
+        return 0;
+    }
+    if (X.cols != model.number_of_features || X.rows != y.dim || X.rows < 1 || batch < 1) {
+        CUSTOM_ERROR("X must have number_of_features columns and as many rows as y, 'batch' must be at least 1");
+        return 0;
+    }
+
+    MinibatchTrainer *t = trainer;
+    memset(t, 0, sizeof(MinibatchTrainer));
+    t->model = model;
+    t->schedule = schedule;
+    t->rng = rng;
+    t->X = X;
+    t->y = y;
+    t->batch = batch;
+    t->alpha = alpha;
+    t->lambda = lambda;
+    t->ratio = ratio;
+
+    const ThreadPool *pool = clearn_thread_pool();
+    const int workers = pool && schedule != MINIBATCH_SERIAL ? pool->num_threads : 1;
+    const int batch_cap = batch < X.rows ? batch : X.rows;
+    if (schedule == MINIBATCH_HOGWILD) {
+        const int batches = (X.rows + batch - 1) / batch;
+        t->tasks = workers < batches ? workers : batches;
+        const int shard_cap = (X.rows + t->tasks - 1) / t->tasks;
+        t->task_rows = batch_cap < shard_cap ? batch_cap : shard_cap;
+    } else {
+        const int slices = (batch_cap + MINIBATCH_MIN_SLICE_ROWS - 1) / MINIBATCH_MIN_SLICE_ROWS;
+        t->tasks = workers < slices ? workers : slices;
+        int slice = (batch_cap + t->tasks - 1) / t->tasks;
+        if (slice < MINIBATCH_MIN_SLICE_ROWS) slice = MINIBATCH_MIN_SLICE_ROWS;
+        t->task_rows = batch_cap < slice ? batch_cap : slice;
+    }
+
+    t->buffer_size = (size_t)t->task_rows * (X.cols + 2) + X.cols;
+    t->indices = vector_create(X.rows);
+    t->buffers = malloc(sizeof(double) * t->buffer_size * t->tasks);
+    t->losses = malloc(sizeof(double) * t->tasks);
+    t->intercept_grads = malloc(sizeof(double) * t->tasks);
+    if (!t->indices || !t->buffers || !t->losses || !t->intercept_grads) {
+        ALLOCATION_ERROR();
+        minibatch_free(t);
+        return 0;
+    }
+    for (int i = 0; i < X.rows; i++) {
+        t->indices->data[i] = i;
+    }
+    if (schedule != MINIBATCH_HOGWILD) {
+        return 1;
+    }
+
+    vector_shuffle_r(t->indices, rng);
+    t->shards = calloc(t->tasks, sizeof(Vector *));
+    t->rngs = malloc(sizeof(pcg32_random_t) * t->tasks);
+    if (!t->shards || !t->rngs) {
+        ALLOCATION_ERROR();
+        minibatch_free(t);
+        return 0;
+    }
+    const uint64_t seed_high = pcg32_random_r(rng);
+    const uint64_t seed = seed_high << 32 | pcg32_random_r(rng);
+    for (int task = 0; task < t->tasks; task++) {
+        const int start = (int)((long long)X.rows * task / t->tasks);
+        const int end = (int)((long long)X.rows * (task + 1) / t->tasks);
+        t->shards[task] = vector_create(end - start);
+        if (!t->shards[task]) {
+            ALLOCATION_ERROR();
+            minibatch_free(t);
+            return 0;
+        }
+        memcpy(t->shards[task]->data, t->indices->data + start, sizeof(double) * (end - start));
+        pcg32_seed_stream_r(&t->rngs[task], seed, (uint64_t)task);
+    }
+    return 1;
+}
+
+double minibatch_epoch(MinibatchTrainer *trainer) {
+    if (!trainer) {
+        NULL_ERROR("Minibatch trainer");
+        return NAN;
+    }
+    ThreadPool *pool = clearn_thread_pool();
+    return trainer->schedule == MINIBATCH_HOGWILD ? minibatch_hogwild_epoch(trainer, pool) : minibatch_sync_epoch(trainer, pool);
+}
@@ -0,0 +1,62 @@
+#ifndef MINIBATCH_H
+#define MINIBATCH_H
+
+#include "../matrix/matrix.h"
+#include "../random/random.h"
+
+typedef enum {
+    MINIBATCH_SERIAL,
+    MINIBATCH_SYNC,
+    MINIBATCH_HOGWILD
+} MinibatchSchedule;
+
+// A linear model trained by minibatch SGD. gradient returns the summed loss of n rows of X (row stride ldx) with
+// targets y[i * y_stride] at the current coefficients, writing the summed gradient to grad (number_of_features
+// values) and the intercept's to *intercept_grad, with y_hats as scratch for n values. update applies a summed
+// gradient of n rows together with the penalty
+typedef struct {
+    void *model;
+    int number_of_features;
+    double (*gradient)(const void *model, const double *X, int ldx, const double *y, int y_stride, int n, double *grad, double *intercept_grad, double *y_hats);
+    void (*update)(void *model, const double *grad, double intercept_grad, int n, double alpha, double lambda, double ratio);
+} MinibatchModel;
+
+// State of minibatch training shared by its tasks. Every task owns a buffer of task_rows gathered rows, their
+// targets, as many predictions and a gradient
+typedef struct {
+    MinibatchModel model;
+    MinibatchSchedule schedule;
+    pcg32_random_t *rng;
+    MatrixView X;
+    VectorView y;
+    int batch;
+    double alpha;
+    double lambda;
+    double ratio;
+    int tasks;
+    int task_rows;
+    size_t buffer_size;
+    double *buffers;
+    double *losses;
+    double *intercept_grads;
+    // Synchronous: the shuffled order, the current batch and the rows of each of its slices
+    Vector *indices;
+    const double *batch_indices;
+    int batch_rows;
+    int slice;
+    // Hogwild: a shard of the shuffled order and a generator per task
+    Vector **shards;
+    pcg32_random_t *rngs;
+} MinibatchTrainer;
+
+// MINIBATCH_SERIAL reshuffles the rows with rng every epoch and updates once per batch on the calling thread.
+// MINIBATCH_SYNC does the same with every batch split into slices whose gradients are computed on the global thread
+// pool and summed in task order, reproducible for a given thread count and identical to the serial schedule on one
+// thread. MINIBATCH_HOGWILD shuffles the rows once into a shard per thread, each thread reshuffles its shard with
+// its own stream and updates the shared coefficients without locks. Returns 0 on allocation failure
+int minibatch_init(MinibatchTrainer *trainer, MinibatchModel model, MinibatchSchedule schedule, pcg32_random_t *rng, MatrixView X, VectorView y, int batch, double alpha, double lambda, double ratio);
+// Runs one epoch and returns the summed loss of its batches, each measured before its update
+double minibatch_epoch(MinibatchTrainer *trainer);
+void minibatch_free(MinibatchTrainer *trainer);
+
+#endif
@@ -3,6 +3,7 @@
 #include "../matrix/matrix.h"
 #include "../vector/vector.h"
 #include "../math_functions/math_functions.h"
+#include "../gemm/gemm.h"
 #include "../random/random.h"
 
 #include <stdlib.h>
@@ -36,6 +37,8 @@ NeuralNetwork *neural_network_create(const int input_size, const int num_layers,
 
     nn->input_size = input_size;
     nn->random_seed = random_seed;
+    pcg32_seed_r(&nn->init_rng, random_seed < 0 ? (uint64_t)time(NULL) : (uint64_t)random_seed);
+    nn->rng = NULL;
     nn->num_layers = num_layers;
     nn->current_num_layers = 0;
     nn->loss_function = loss_function;
@@ -60,6 +63,14 @@ void neural_network_free(NeuralNetwork *neural_network) {
     free(neural_network);
 }
 
+void neural_network_set_rng(NeuralNetwork *neural_network, pcg32_random_t *rng) {
+    if (!neural_network) {
+        NULL_ERROR("NeuralNetwork model");
+        return;
+    }
+    neural_network->rng = rng;
+}
+
 void neural_network_describe(NeuralNetwork *neural_network) {
     if (!neural_network) {
         NULL_ERROR("NeuralNetwork model");
@@ -163,16 +174,298 @@ void neural_network_add_layer(NeuralNetwork *neural_network, const int units, co
     layer->lambda = isnan(lambda) ? 0 : lambda;
     layer->ratio = isnan(ratio) ? 0 : ratio;
 
+    pcg32_random_t *rng = neural_network->rng ? neural_network->rng : &neural_network->init_rng;
     const double limit = math_xavier(layer->coef->rows, layer->coef->cols);
     for (int i = 0; i < layer->coef->rows; i++) {
         for (int j = 0; j < layer->coef->cols; j++) {
-            matrix_set(layer->coef, i, j, pcg32_random_double() * 2.0 * limit - limit);
+            matrix_set(layer->coef, i, j, pcg32_random_double_r(rng) * 2.0 * limit - limit);
         }
     }
 
     neural_network->layers[neural_network->current_num_layers++] = layer;
 }
 
+typedef void (*NeuralNetworkArrayKernel)(const double *in, double *out, size_t n);
+
+static NeuralNetworkArrayKernel neural_network_activation_function(const Activation activation) {
+    switch (activation) {
+        case ReLU: return math_relu_array;
+        case LeakyReLU: return math_leaky_relu_array;
+        case SiLU: return math_silu_array;
+        case Sigmoid: return math_sigmoid_array;
+        case Tanh: return math_tanh_array;
+        default: return NULL;
+    }
+}
+
+// Derivative in terms of the layer output, NULL where it needs the pre-activation (SiLU) or is the identity
+static NeuralNetworkArrayKernel neural_network_output_derivative(const Activation activation) {
+    switch (activation) {
+        case ReLU: return math_derivative_relu_from_output_array;
+        case LeakyReLU: return math_derivative_leaky_relu_from_output_array;
+        case Sigmoid: return math_derivative_sigmoid_from_output_array;
+        case Tanh: return math_derivative_tanh_from_output_array;
+        default: return NULL;
+    }
+}
+
+static void neural_network_softmax_rows(Matrix *A) {
+    for (int i = 0; i < A->rows; i++) {
+        double *a = A->data + (size_t)i * A->cols;
+        const double max_val = matrix_row_max(A, i);
+        for (int j = 0; j < A->cols; j++) {
+            a[j] -= max_val;
+        }
+        math_exp_array(a, a, A->cols);
+        double sum = 0.0;
+        for (int j = 0; j < A->cols; j++) {
+            sum += a[j];
+        }
+        for (int j = 0; j < A->cols; j++) {
+            a[j] /= sum;
+        }
+    }
+}
+
+// delta *= activation'(z), computed from the cached output (post) where possible. Only SiLU reads pre, which
+// is also used as scratch for the derivative
+static void neural_network_apply_derivative(const Activation activation, Matrix *pre, const Matrix *post, Matrix *delta, const int rows) {
+    const size_t n = (size_t)rows * delta->cols;
+    if (activation == SiLU) {
+        math_derivative_silu_array(pre->data, pre->data, n);
+    } else {
+        const NeuralNetworkArrayKernel derivative = neural_network_output_derivative(activation);
+        if (!derivative) {
+            return;
+        }
+        derivative(post->data, pre->data, n);
+    }
+    for (size_t i = 0; i < n; i++) {
+        delta->data[i] *= pre->data[i];
+    }
+}
+
+// out = activation(input * coef + intercepts) in a single GEMM pass, pre (optional) receives the value before
+// the activation. Softmax is not elementwise, so its rows are normalised by the caller
+static void neural_network_dense_forward(const DenseLayer *layer, const MatrixView input, Matrix *pre, Matrix *out) {
+    const GemmEpilogue epilogue = {
+        layer->intercepts->data,
+        neural_network_activation_function(layer->activation),
+        pre ? pre->data : NULL,
+        pre ? pre->cols : 0
+    };
+    gemm_multiply_strided(input.rows, layer->coef->cols, input.cols, input.data, input.row_stride, input.col_stride,
+                          layer->coef->data, layer->coef->cols, 1, out->data, out->cols, &epilogue);
+}
+
+NeuralNetworkWorkspace *neural_network_workspace_create(const NeuralNetwork *neural_network, const int batch_size, const int target_cols) {
+    if (!neural_network) {
+        NULL_ERROR("NeuralNetwork model");
+        return NULL;
+    }
+    if (batch_size <= 0 || target_cols <= 0) {
+        CUSTOM_ERROR("'batch_size' and 'target_cols' must be at least 1");
+        return NULL;
+    }
+    if (neural_network->current_num_layers == 0) {
+        CUSTOM_ERROR("No layers added to the network");
+        return NULL;
+    }
+
+    const int L = neural_network->current_num_layers;
+    NeuralNetworkWorkspace *ws = calloc(1, sizeof(NeuralNetworkWorkspace));
+    if (!ws) {
+        ALLOCATION_ERROR();
+        return NULL;
+    }
+    ws->num_layers = L;
+    ws->batch_size = batch_size;
+    ws->pre = calloc(L, sizeof(Matrix *));
+    ws->post = calloc(L + 1, sizeof(Matrix *));
+    ws->deltas = calloc(L, sizeof(Matrix *));
+    ws->dW = calloc(L, sizeof(Matrix *));
+    ws->db = calloc(L, sizeof(Vector *));
+    if (!ws->pre || !ws->post || !ws->deltas || !ws->dW || !ws->db) {
+        ALLOCATION_ERROR();
+        neural_network_workspace_free(ws);
+        return NULL;
+    }
+
+    int ok = (ws->X_batch = matrix_create(batch_size, neural_network->input_size)) != NULL;
+    ok = ok && (ws->y_batch = matrix_create(batch_size, target_cols)) != NULL;
+    ws->post[0] = ws->X_batch;
+    for (int l = 0; l < L && ok; l++) {
+        const DenseLayer *layer = neural_network->layers[l];
+        ok = (ws->pre[l] = matrix_create(batch_size, layer->units)) != NULL
+            && (ws->post[l + 1] = matrix_create(batch_size, layer->units)) != NULL
+            && (ws->deltas[l] = matrix_create(batch_size, layer->units)) != NULL
+            && (ws->dW[l] = matrix_create(layer->coef->rows, layer->coef->cols)) != NULL
+            && (ws->db[l] = vector_create(layer->units)) != NULL;
+    }
+    if (!ok) {
+        ALLOCATION_ERROR();
+        neural_network_workspace_free(ws);
+        return NULL;
+    }
+
+    return ws;
+}
+
+void neural_network_workspace_free(NeuralNetworkWorkspace *ws) {
+    if (!ws) {
+        NULL_ERROR("NeuralNetworkWorkspace");
+        return;
+    }
+
+    for (int l = 0; l < ws->num_layers; l++) {
+        if (ws->pre && ws->pre[l]) matrix_free(ws->pre[l]);
+        if (ws->post && ws->post[l + 1]) matrix_free(ws->post[l + 1]);
+        if (ws->deltas && ws->deltas[l]) matrix_free(ws->deltas[l]);
+        if (ws->dW && ws->dW[l]) matrix_free(ws->dW[l]);
+        if (ws->db && ws->db[l]) vector_free(ws->db[l]);
+    }
+    if (ws->X_batch) matrix_free(ws->X_batch);
+    if (ws->y_batch) matrix_free(ws->y_batch);
+    free(ws->pre);
+    free(ws->post);
+    free(ws->deltas);
+    free(ws->dW);
+    free(ws->db);
+    free(ws);
+}
+
+// Buffers are sized for batch_size rows; the last, shorter minibatch of an epoch only uses a prefix
+static void neural_network_workspace_set_rows(NeuralNetworkWorkspace *ws, const int rows) {
+    ws->X_batch->rows = rows;
+    ws->y_batch->rows = rows;
+    for (int l = 0; l < ws->num_layers; l++) {
+        ws->pre[l]->rows = rows;
+        ws->post[l + 1]->rows = rows;
+        ws->deltas[l]->rows = rows;
+    }
+}
+
+// Forward and backward pass over the first bs rows already in ws->X_batch / ws->y_batch: ws->dW and ws->db receive
+// the gradients summed over the batch, without the penalties. Returns loss plus the summed loss of the batch
+static double neural_network_gradients(const NeuralNetwork *neural_network, NeuralNetworkWorkspace *ws, const int bs, double loss) {
+    const int L = neural_network->current_num_layers;
+    Matrix **pre = ws->pre;
+    Matrix **post = ws->post;
+    Matrix **deltas = ws->deltas;
+    const Matrix *y_batch = ws->y_batch;
+
+    for (int l = 0; l < L; l++) {
+        const DenseLayer *layer = neural_network->layers[l];
+
+        Matrix *A = post[l + 1];
+        neural_network_dense_forward(layer, matrix_view(post[l]), layer->activation == SiLU ? pre[l] : NULL, A);
+
+        if (layer->activation == Softmax) {
+            neural_network_softmax_rows(A);
+        }
+    }
+
+    const size_t n_out = (size_t)bs * post[L]->cols;
+    const double *y_hats = post[L]->data;
+    const double *y_trues = y_batch->data;
+    switch (neural_network->loss_function) {
+        case MSE:
+            for (size_t i = 0; i < n_out; i++) {
+                const double diff = y_hats[i] - y_trues[i];
+                loss += diff * diff;
+            }
+            break;
+        case BinaryCrossEntropy: {
+            const double eps = 1e-15;
+            for (size_t i = 0; i < n_out; i++) {
+                loss += -y_trues[i] * log(y_hats[i] + eps) - (1.0 - y_trues[i]) * log(1.0 - y_hats[i] + eps);
+            }
+            break;
+        }
+        case CategoricalCrossEntropy: {
+            const double eps = 1e-15;
+            for (size_t i = 0; i < n_out; i++) {
+                loss += -y_trues[i] * log(y_hats[i] + eps);
+            }
+            break;
+        }
+    }
+
+    Matrix *delta_out = deltas[L - 1];
+    for (size_t i = 0; i < n_out; i++) {
+        delta_out->data[i] = y_hats[i] - y_trues[i];
+    }
+    if (neural_network->loss_function == MSE) {
+        neural_network_apply_derivative(neural_network->layers[L - 1]->activation, pre[L - 1], post[L], delta_out, bs);
+    }
+    for (int l = L - 2; l >= 0; l--) {
+        Matrix *delta_l = deltas[l];
+        matrix_multiplication_nt_into(delta_l, deltas[l + 1], neural_network->layers[l + 1]->coef);
+        neural_network_apply_derivative(neural_network->layers[l]->activation, pre[l], post[l + 1], delta_l, bs);
+    }
+
+    for (int l = 0; l < L; l++) {
+        matrix_multiplication_tn_into(ws->dW[l], post[l], deltas[l]);
+
+        const int units = neural_network->layers[l]->intercepts->dim;
+        double *db = ws->db[l]->data;
+        memset(db, 0, sizeof(double) * units);
+        for (int i = 0; i < bs; i++) {
+            const double *d = deltas[l]->data + (size_t)i * units;
+            for (int j = 0; j < units; j++) {
+                db[j] += d[j];
+            }
+        }
+    }
+    return loss;
+}
+
+// Forward, backward and update for the first bs rows already in ws->X_batch / ws->y_batch. The batch loss is
+// added to *total_loss
+static void neural_network_train_batch(NeuralNetwork *neural_network, NeuralNetworkWorkspace *ws, const int bs, const double learning_rate, double *total_loss) {
+    *total_loss = neural_network_gradients(neural_network, ws, bs, *total_loss);
+
+    for (int l = 0; l < neural_network->current_num_layers; l++) {
+        const Matrix *dW = ws->dW[l];
+        const DenseLayer *layer = neural_network->layers[l];
+        const double lambda = layer->lambda;
+        const double ratio  = layer->ratio;
+
+        double *W = layer->coef->data;
+        const double *dw = dW->data;
+        const size_t n_weights = (size_t)layer->coef->rows * layer->coef->cols;
+        for (size_t i = 0; i < n_weights; i++) {
+            const double grad = dw[i] / bs;
+            double w = W[i];
+            switch (layer->penalty) {
+                case L2_RIDGE:
+                    w -= learning_rate * (grad + lambda * w);
+                    break;
+                case L1_LASSO:
+                    w -= learning_rate * (grad + lambda * (w > 0 ? 1.0 : -1.0));
+                    break;
+                case ELASTIC_NET: {
+                    const double l1 = ratio * (w > 0 ? 1.0 : -1.0);
+                    const double l2 = (1.0 - ratio) * w;
+                    w -= learning_rate * (grad + lambda * (l1 + l2));
+                    break;
+                }
+                default:
+                    w -= learning_rate * grad;
+                    break;
+            }
+            W[i] = w;
+        }
+
+        const int units = layer->intercepts->dim;
+        const double *db = ws->db[l]->data;
+        double *b = layer->intercepts->data;
+        for (int j = 0; j < units; j++) {
+            b[j] -= learning_rate * (db[j] / bs);
+        }
+    }
+}
+
 void neural_network_fit(NeuralNetwork *neural_network, Matrix *X, Matrix *y, int epochs, double learning_rate, int batch_size) {
     if (!neural_network) {
         NULL_ERROR("NeuralNetwork model");
@@ -210,11 +503,20 @@ void neural_network_fit(NeuralNetwork *neural_network, Matrix *X, Matrix *y, int
         CUSTOM_ERROR("X->cols must equal input_size");
         return;
     }
+    if (y->cols != neural_network->layers[neural_network->current_num_layers - 1]->units) {
+        CUSTOM_ERROR("y->cols must equal the units of the last layer");
+        return;
+    }
 
-    const uint64_t seed = neural_network->random_seed < 0 ? (uint64_t)time(NULL) : (uint64_t)neural_network->random_seed;
-    pcg32_seed(seed);
+    // Every fit shuffles the same way unless the caller's generator is set
+    pcg32_random_t seeded;
+    pcg32_random_t *rng = neural_network->rng;
+    if (!rng) {
+        const uint64_t seed = neural_network->random_seed < 0 ? (uint64_t)time(NULL) : (uint64_t)neural_network->random_seed;
+        pcg32_seed_r(&seeded, seed);
+        rng = &seeded;
+    }
 
-    const int L = neural_network->current_num_layers;
     const int N = X->rows;
 
     Vector *indices = vector_create(N);
@@ -223,280 +525,283 @@ void neural_network_fit(NeuralNetwork *neural_network, Matrix *X, Matrix *y, int
         return;
     }
     for (int i = 0; i < N; i++) {
-        vector_set(indices, i, i);
+        indices->data[i] = i;
+    }
+
+    NeuralNetworkWorkspace *ws = neural_network_workspace_create(neural_network, batch_size, y->cols);
+    if (!ws) {
+        ALLOCATION_ERROR();
+        vector_free(indices);
+        return;
     }
 
     for (int epoch = 0; epoch < epochs; epoch++) {
-        vector_shuffle(indices);
+        vector_shuffle_r(indices, rng);
         double total_loss = 0.0;
 
         for (int k = 0; k < N; k += batch_size) {
             const int bs = k + batch_size > N ? N - k : batch_size;
+            neural_network_workspace_set_rows(ws, bs);
 
-            Matrix *X_batch = matrix_create(bs, X->cols);
-            Matrix *y_batch = matrix_create(bs, y->cols);
-            if (!X_batch || !y_batch) {
-                ALLOCATION_ERROR(); vector_free(indices);
-                return;
-            }
+            Matrix *X_batch = ws->X_batch;
+            Matrix *y_batch = ws->y_batch;
 
             for (int i = 0; i < bs; i++) {
-                const int row = (int)vector_get(indices, k + i);
-                for (int j = 0; j < X->cols; j++) {
-                    matrix_set(X_batch, i, j, matrix_get(X, row, j));
-                }
-                for (int j = 0; j < y->cols; j++) {
-                    matrix_set(y_batch, i, j, matrix_get(y, row, j));
-                }
-
+                const int row = (int)indices->data[k + i];
+                memcpy(X_batch->data + (size_t)i * X->cols, X->data + (size_t)row * X->cols, sizeof(double) * X->cols);
+                memcpy(y_batch->data + (size_t)i * y->cols, y->data + (size_t)row * y->cols, sizeof(double) * y->cols);
             }
 
-            Matrix *post[L + 1];
-            Matrix *pre[L];
-            post[0] = X_batch;
+            neural_network_train_batch(neural_network, ws, bs, learning_rate, &total_loss);
+        }
 
-            for (int l = 0; l < L; l++) {
-                const DenseLayer *layer = neural_network->layers[l];
+        printf("Epoch: %d | Loss: [%lf]\n", epoch + 1, total_loss / N);
+    }
 
-                Matrix *Z = matrix_multiplication(post[l], layer->coef);
+    neural_network_workspace_free(ws);
+    vector_free(indices);
+}
 
-                for (int i = 0; i < Z->rows; i++) {
-                    for (int j = 0; j < Z->cols; j++) {
-                        matrix_set(Z, i, j, matrix_get(Z, i, j) + vector_get(layer->intercepts, j));
-                    }
-                }
+typedef struct {
+    NeuralNetwork *neural_network;
+    NeuralNetworkWorkspace *ws;
+    int rows;
+} NeuralNetworkLbfgsTask;
+
+// Parameters are every layer's weights followed by its intercepts. The loss matches the gradients of
+// neural_network_gradients, which for MSE are those of half the squared error
+static double neural_network_lbfgs_objective(void *ctx, const double *params, double *grad) {
+    const NeuralNetworkLbfgsTask *t = ctx;
+    const NeuralNetwork *neural_network = t->neural_network;
+    const int L = neural_network->current_num_layers;
 
-                pre[l] = Z;
-                Matrix *A = matrix_copy(Z);
-
-                if (layer->activation != Softmax) {
-                    for (int i = 0; i < A->rows; i++) {
-                        for (int j = 0; j < A->cols; j++) {
-                            double val = matrix_get(A, i, j);
-                            switch (layer->activation) {
-                                case ReLU: val = math_relu(val); break;
-                                case LeakyReLU: val = math_leaky_relu(val); break;
-                                case SiLU: val = math_silu(val); break;
-                                case Sigmoid: val = math_sigmoid(val); break;
-                                case Tanh: val = math_tanh(val); break;
-                                default: break;
-                            }
-                            matrix_set(A, i, j, val);
-                        }
-                    }
-                } else {
-                    for (int i = 0; i < A->rows; i++) {
-                        const double max_val = matrix_row_max(A, i);
-                        double sum = 0.0;
-                        for (int j = 0; j < A->cols; j++) {
-                            const double e = exp(matrix_get(A, i, j) - max_val);
-                            matrix_set(A, i, j, e);
-                            sum += e;
-                        }
-                        for (int j = 0; j < A->cols; j++) {
-                            matrix_set(A, i, j, matrix_get(A, i, j) / sum);
-                        }
-                    }
-                }
+    for (int l = 0; l < L; l++) {
+        const DenseLayer *layer = neural_network->layers[l];
+        const size_t n_weights = (size_t)layer->coef->rows * layer->coef->cols;
+        memcpy(layer->coef->data, params, sizeof(double) * n_weights);
+        memcpy(layer->intercepts->data, params + n_weights, sizeof(double) * layer->units);
+        params += n_weights + layer->units;
+    }
 
-                post[l + 1] = A;
-            }
+    const double loss = neural_network_gradients(neural_network, t->ws, t->rows, 0.0);
+    const double inv_n = 1.0 / t->rows;
+    double penalty = 0;
+    for (int l = 0; l < L; l++) {
+        const DenseLayer *layer = neural_network->layers[l];
+        const double lambda = layer->penalty == L2_RIDGE ? layer->lambda : 0.0;
+        const size_t n_weights = (size_t)layer->coef->rows * layer->coef->cols;
+        const double *W = layer->coef->data;
+        const double *dw = t->ws->dW[l]->data;
+        for (size_t i = 0; i < n_weights; i++) {
+            grad[i] = dw[i] * inv_n + lambda * W[i];
+            penalty += 0.5 * lambda * W[i] * W[i];
+        }
+        const double *db = t->ws->db[l]->data;
+        for (int j = 0; j < layer->units; j++) {
+            grad[n_weights + j] = db[j] * inv_n;
+        }
+        grad += n_weights + layer->units;
+    }
+    return (neural_network->loss_function == MSE ? 0.5 : 1.0) * loss * inv_n + penalty;
+}
 
-            for (int i = 0; i < bs; i++) {
-                for (int j = 0; j < post[L]->cols; j++) {
-                    const double y_hat = matrix_get(post[L], i, j);
-                    const double y_true = matrix_get(y_batch, i, j);
-                    switch (neural_network->loss_function) {
-                        case MSE: {
-                            const double diff = y_hat - y_true;
-                            total_loss += diff * diff;
-                            break;
-                        }
-                        case BinaryCrossEntropy: {
-                            const double eps = 1e-15;
-                            total_loss += -y_true * log(y_hat + eps) - (1.0 - y_true) * log(1.0 - y_hat + eps);
-                            break;
-                        }
-                        case CategoricalCrossEntropy: {
-                            const double eps = 1e-15;
-                            total_loss += -y_true * log(y_hat + eps);
-                            break;
-                        }
-                    }
-                }
-            }
+void neural_network_fit_lbfgs(NeuralNetwork *neural_network, Matrix *X, Matrix *y, const LbfgsOptions *options) {
+    if (!neural_network) {
+        NULL_ERROR("NeuralNetwork model");
+        return;
+    }
+    if (!X) {
+        NULL_ERROR("X matrix");
+        return;
+    }
+    if (!y) {
+        NULL_ERROR("y matrix");
+        return;
+    }
+    if (neural_network->current_num_layers == 0) {
+        CUSTOM_ERROR("No layers added to the network");
+        return;
+    }
+    if (X->rows != y->rows) {
+        CUSTOM_ERROR("X->rows must equal y->rows");
+        return;
+    }
+    if (X->cols != neural_network->input_size) {
+        CUSTOM_ERROR("X->cols must equal input_size");
+        return;
+    }
+    const int L = neural_network->current_num_layers;
+    if (y->cols != neural_network->layers[L - 1]->units) {
+        CUSTOM_ERROR("y->cols must equal the units of the last layer");
+        return;
+    }
+    // The output delta y_hat - y is the exact gradient of a cross-entropy only through its matching output
+    // activation, and the line search needs the exact gradient of the loss it measures
+    const Activation output = neural_network->layers[L - 1]->activation;
+    const LossFunction loss_function = neural_network->loss_function;
+    if ((loss_function == BinaryCrossEntropy && output != Sigmoid) || (loss_function == CategoricalCrossEntropy && output != Softmax) || (loss_function == MSE && output == Softmax)) {
+        CUSTOM_ERROR("L-BFGS training needs a Sigmoid output with BinaryCrossEntropy, a Softmax output with CategoricalCrossEntropy and a non-Softmax output with MSE");
+        return;
+    }
 
-            Matrix *deltas[L];
-            Matrix *delta_out = matrix_create(bs, neural_network->layers[L - 1]->units);
-            if (!delta_out) {
-                ALLOCATION_ERROR(); vector_free(indices);
-                return;
-            }
+    int n_params = 0;
+    for (int l = 0; l < L; l++) {
+        const DenseLayer *layer = neural_network->layers[l];
+        if (layer->penalty != NO_PENALTY && layer->penalty != L2_RIDGE) {
+            CUSTOM_ERROR("L-BFGS training supports layers with NO_PENALTY and L2_RIDGE only");
+            return;
+        }
+        n_params += layer->coef->rows * layer->coef->cols + layer->units;
+    }
 
-            for (int i = 0; i < bs; i++) {
-                for (int j = 0; j < delta_out->cols; j++) {
-                    const double y_hat = matrix_get(post[L], i, j);
-                    const double y_true = matrix_get(y_batch, i, j);
-                    double d = y_hat - y_true;
-
-                    if (neural_network->loss_function == MSE) {
-                        const double z = matrix_get(pre[L - 1], i, j);
-                        switch (neural_network->layers[L - 1]->activation) {
-                            case ReLU: d *= math_derivative_relu(z); break;
-                            case LeakyReLU: d *= math_derivative_leaky_relu(z); break;
-                            case SiLU: d *= math_derivative_silu(z); break;
-                            case Sigmoid: d *= math_derivative_sigmoid(z); break;
-                            case Tanh: d *= math_derivative_tanh(z); break;
-                            default: break;
-                        }
-                    }
-                    matrix_set(delta_out, i, j, d);
-                }
-            }
-            deltas[L - 1] = delta_out;
-            for (int l = L - 2; l >= 0; l--) {
-                Matrix *W_T  = matrix_transpose(neural_network->layers[l + 1]->coef, 0);
-                Matrix *prop = matrix_multiplication(deltas[l + 1], W_T);
-                matrix_free(W_T);
-
-                Matrix *delta_l = matrix_create(bs, neural_network->layers[l]->units);
-                if (!delta_l) {
-                    ALLOCATION_ERROR(); vector_free(indices);
-                    matrix_free(pre);
-                    matrix_free(post);
-                    return;
-                }
+    double *params = malloc(sizeof(double) * n_params);
+    NeuralNetworkWorkspace *ws = neural_network_workspace_create(neural_network, X->rows, y->cols);
+    if (!params || !ws) {
+        ALLOCATION_ERROR();
+        free(params);
+        if (ws) neural_network_workspace_free(ws);
+        return;
+    }
+    memcpy(ws->X_batch->data, X->data, sizeof(double) * X->rows * X->cols);
+    memcpy(ws->y_batch->data, y->data, sizeof(double) * y->rows * y->cols);
+
+    double *p = params;
+    for (int l = 0; l < L; l++) {
+        const DenseLayer *layer = neural_network->layers[l];
+        const size_t n_weights = (size_t)layer->coef->rows * layer->coef->cols;
+        memcpy(p, layer->coef->data, sizeof(double) * n_weights);
+        memcpy(p + n_weights, layer->intercepts->data, sizeof(double) * layer->units);
+        p += n_weights + layer->units;
+    }
 
-                for (int i = 0; i < bs; i++) {
-                    for (int j = 0; j < delta_l->cols; j++) {
-                        const double z = matrix_get(pre[l], i, j);
-                        double deriv;
-                        switch (neural_network->layers[l]->activation) {
-                            case ReLU: deriv = math_derivative_relu(z); break;
-                            case LeakyReLU: deriv = math_derivative_leaky_relu(z); break;
-                            case SiLU: deriv = math_derivative_silu(z); break;
-                            case Sigmoid: deriv = math_derivative_sigmoid(z); break;
-                            case Tanh: deriv = math_derivative_tanh(z); break;
-                            default: deriv = 1.0; break;
-                        }
-                        matrix_set(delta_l, i, j, matrix_get(prop, i, j) * deriv);
-                    }
-                }
-                matrix_free(prop);
-                deltas[l] = delta_l;
-            }
+    // The objective writes every trial point into the layers, the accepted one is written back at the end
+    NeuralNetworkLbfgsTask task = {neural_network, ws, X->rows};
+    if (lbfgs_minimize(neural_network_lbfgs_objective, &task, n_params, params, options) >= 0) {
+        p = params;
+        for (int l = 0; l < L; l++) {
+            const DenseLayer *layer = neural_network->layers[l];
+            const size_t n_weights = (size_t)layer->coef->rows * layer->coef->cols;
+            memcpy(layer->coef->data, p, sizeof(double) * n_weights);
+            memcpy(layer->intercepts->data, p + n_weights, sizeof(double) * layer->units);
+            p += n_weights + layer->units;
+        }
+    }
 
-            for (int l = 0; l < L; l++) {
-                Matrix *post_T = matrix_transpose(post[l], 0);
-                Matrix *dW = matrix_multiplication(post_T, deltas[l]);
-                matrix_free(post_T);
-
-                const double lambda = neural_network->layers[l]->lambda;
-                const double ratio  = neural_network->layers[l]->ratio;
-
-                for (int i = 0; i < neural_network->layers[l]->coef->rows; i++) {
-                    for (int j = 0; j < neural_network->layers[l]->coef->cols; j++) {
-                        const double grad = matrix_get(dW, i, j) / bs;
-                        double w = matrix_get(neural_network->layers[l]->coef, i, j);
-                        switch (neural_network->layers[l]->penalty) {
-                            case L2_RIDGE:
-                                w -= learning_rate * (grad + lambda * w);
-                                break;
-                            case L1_LASSO:
-                                w -= learning_rate * (grad + lambda * (w > 0 ? 1.0 : -1.0));
-                                break;
-                            case ELASTIC_NET: {
-                                const double l1 = ratio * (w > 0 ? 1.0 : -1.0);
-                                const double l2 = (1.0 - ratio) * w;
-                                w -= learning_rate * (grad + lambda * (l1 + l2));
-                                break;
-                            }
-                            default:
-                                w -= learning_rate * grad;
-                                break;
-                        }
-                        matrix_set(neural_network->layers[l]->coef, i, j, w);
-                    }
-                }
-                matrix_free(dW);
-
-                for (int j = 0; j < neural_network->layers[l]->intercepts->dim; j++) {
-                    double db = 0.0;
-                    for (int i = 0; i < bs; i++)
-                        db += matrix_get(deltas[l], i, j);
-                    const double b = vector_get(neural_network->layers[l]->intercepts, j);
-                    vector_set(neural_network->layers[l]->intercepts, j, b - learning_rate * (db / bs));
-                }
-            }
+    neural_network_workspace_free(ws);
+    free(params);
+}
+
+void neural_network_fit_stream(NeuralNetwork *neural_network, CsvStream *stream, const int epochs, const double learning_rate, const int batch_size) {
+    if (!neural_network) {
+        NULL_ERROR("NeuralNetwork model");
+        return;
+    }
+    if (!stream) {
+        NULL_ERROR("CsvStream");
+        return;
+    }
+    if (epochs <= 0) {
+        CUSTOM_ERROR("'epochs' must be at least 1");
+        return;
+    }
+    if (learning_rate <= 0) {
+        CUSTOM_ERROR("'learning_rate' must be positive");
+        return;
+    }
+    if (batch_size <= 0) {
+        CUSTOM_ERROR("'batch_size' must be at least 1");
+        return;
+    }
+    if (neural_network->current_num_layers == 0) {
+        CUSTOM_ERROR("No layers added to the network");
+        return;
+    }
+    const int input_size = neural_network->input_size;
+    const int target_cols = stream->cols - input_size;
+    if (target_cols != neural_network->layers[neural_network->current_num_layers - 1]->units) {
+        CUSTOM_ERROR("Stream must have input_size + output units columns (features, then the targets)");
+        return;
+    }
+
+    Matrix *rows = matrix_create(batch_size, stream->cols);
+    if (!rows) {
+        ALLOCATION_ERROR();
+        return;
+    }
+    NeuralNetworkWorkspace *ws = neural_network_workspace_create(neural_network, batch_size, target_cols);
+    if (!ws) {
+        ALLOCATION_ERROR();
+        matrix_free(rows);
+        return;
+    }
+
+    for (int epoch = 0; epoch < epochs; epoch++) {
+        csv_stream_rewind(stream);
+        double total_loss = 0.0;
+        long long seen = 0;
 
-            for (int l = 0; l < L; l++) matrix_free(pre[l]);
-            for (int l = 1; l <= L; l++) matrix_free(post[l]);
-            for (int l = 0; l < L; l++) matrix_free(deltas[l]);
-            matrix_free(X_batch);
-            matrix_free(y_batch);
+        int bs;
+        while ((bs = csv_stream_next_batch(stream, rows, batch_size)) > 0) {
+            neural_network_workspace_set_rows(ws, bs);
+            for (int i = 0; i < bs; i++) {
+                const double *row = rows->data + (size_t)i * stream->cols;
+                memcpy(ws->X_batch->data + (size_t)i * input_size, row, sizeof(double) * input_size);
+                memcpy(ws->y_batch->data + (size_t)i * target_cols, row + input_size, sizeof(double) * target_cols);
+            }
+            neural_network_train_batch(neural_network, ws, bs, learning_rate, &total_loss);
+            seen += bs;
         }
 
-        printf("Epoch: %d | Loss: [%lf]\n", epoch + 1, total_loss / N);
+        printf("Epoch: %d | Loss: [%lf]\n", epoch + 1, total_loss / (double)seen);
     }
 
-    vector_free(indices);
+    neural_network_workspace_free(ws);
+    matrix_free(rows);
 }
 
 Matrix *neural_network_predict(NeuralNetwork *neural_network, Matrix *X) {
+    if (!X) {
+        NULL_ERROR("X matrix");
+        return NULL;
+    }
+    return neural_network_predict_view(neural_network, matrix_view(X));
+}
+
+Matrix *neural_network_predict_view(NeuralNetwork *neural_network, const MatrixView X) {
     if (!neural_network) {
         NULL_ERROR("NeuralNetwork model");
         return NULL;
     }
-    if (!X) {
-        NULL_ERROR("X matrix");
+    if (!X.data) {
+        NULL_ERROR("MatrixView");
         return NULL;
     }
-
-    Matrix *current = matrix_copy(X);
-    if (!current) {
-        ALLOCATION_ERROR();
+    if (X.cols != neural_network->input_size) {
+        CUSTOM_ERROR("X->cols must equal input_size");
         return NULL;
     }
 
+    MatrixView input = X;
+    Matrix *current = NULL;
+
     for (int x = 0; x < neural_network->current_num_layers; x++) {
         const DenseLayer *layer = neural_network->layers[x];
 
-        Matrix *Z = matrix_multiplication(current, layer->coef);
-        for (int i = 0; i < Z->rows; i++) {
-            for (int j = 0; j < Z->cols; j++) {
-                double new_val = matrix_get(Z, i, j) + vector_get(layer->intercepts, j);
-                switch (layer->activation) {
-                    case ReLU: new_val = math_relu(new_val); break;
-                    case LeakyReLU: new_val = math_leaky_relu(new_val); break;
-                    case SiLU: new_val = math_silu(new_val); break;
-                    case Sigmoid: new_val = math_sigmoid(new_val); break;
-                    case Tanh: new_val = math_tanh(new_val); break;
-                    default: break;
-                }
-                matrix_set(Z, i, j, new_val);
-            }
+        Matrix *Z = matrix_create(input.rows, layer->units);
+        if (!Z) {
+            ALLOCATION_ERROR();
+            if (current) matrix_free(current);
+            return NULL;
         }
+        neural_network_dense_forward(layer, input, NULL, Z);
 
         if (layer->activation == Softmax) {
-            for (int i = 0; i < Z->rows; i++) {
-
-                const double max_val = matrix_row_max(Z, i);
-
-                double sum = 0.0;
-                for (int j = 0; j < Z->cols; j++) {
-                    const double e = exp(matrix_get(Z, i, j) - max_val);
-                    matrix_set(Z, i, j, e);
-                    sum += e;
-                }
-
-                for (int j = 0; j < Z->cols; j++) {
-                    matrix_set(Z, i, j, matrix_get(Z, i, j) / sum);
-                }
-            }
+            neural_network_softmax_rows(Z);
         }
 
-        matrix_free(current);
+        if (current) matrix_free(current);
         current = Z;
+        input = matrix_view(Z);
     }
 
     return current;
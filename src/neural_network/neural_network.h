@@ -1,8 +1,11 @@
 ﻿#ifndef NEURAL_NETWORKS_H
 #define NEURAL_NETWORKS_H
+#include "../csv/csv.h"
+#include "../lbfgs/lbfgs.h"
 #include "../matrix/matrix.h"
 #include "../vector/vector.h"
 #include "../penalty_types/penalty_types.h"
+#include "../random/random.h"
 
 typedef enum {
     BinaryCrossEntropy,
@@ -34,19 +37,49 @@ typedef struct DenseLayer {
 typedef struct {
     int input_size;
     int random_seed;
+    // Draws the weights of added layers, seeded from random_seed by neural_network_create
+    pcg32_random_t init_rng;
+    pcg32_random_t *rng;
     int num_layers;
     int current_num_layers;
     DenseLayer **layers;
     LossFunction loss_function;
 } NeuralNetwork;
 
+typedef struct {
+    int num_layers;
+    int batch_size;
+    Matrix *X_batch;
+    Matrix *y_batch;
+    Matrix **pre;
+    Matrix **post;
+    Matrix **deltas;
+    Matrix **dW;
+    Vector **db;
+} NeuralNetworkWorkspace;
+
 NeuralNetwork *neural_network_create(int input_size, int num_layers, LossFunction loss_function, int random_seed);
 void neural_network_free(NeuralNetwork *neural_network);
 void neural_network_describe(NeuralNetwork *neural_network);
+// Draws the weights of layers added from now on and the shuffles of neural_network_fit from rng, a caller-owned
+// generator that advances, instead of the network's own generators seeded with random_seed. NULL goes back to those
+void neural_network_set_rng(NeuralNetwork *neural_network, pcg32_random_t *rng);
 
 void neural_network_add_layer(NeuralNetwork *neural_network, int units, Activation activation, Penalty penalty, double lambda, double ratio, const char *name);
 
+NeuralNetworkWorkspace *neural_network_workspace_create(const NeuralNetwork *neural_network, int batch_size, int target_cols);
+void neural_network_workspace_free(NeuralNetworkWorkspace *ws);
+
 void neural_network_fit(NeuralNetwork *neural_network, Matrix *X, Matrix *y, int epochs, double learning_rate, int batch_size);
+// Full-batch training with L-BFGS from the current weights, on the loss and gradients neural_network_fit uses (half
+// the squared error for MSE). Every layer must use NO_PENALTY or L2_RIDGE and the output activation must match the
+// loss: Sigmoid for BinaryCrossEntropy, Softmax for CategoricalCrossEntropy and anything but Softmax for MSE.
+// options may be NULL for the defaults
+void neural_network_fit_lbfgs(NeuralNetwork *neural_network, Matrix *X, Matrix *y, const LbfgsOptions *options);
+// Trains from a stream whose rows are input_size features followed by the targets, rewinding it every epoch.
+// Batches follow file order, there is no shuffling
+void neural_network_fit_stream(NeuralNetwork *neural_network, CsvStream *stream, int epochs, double learning_rate, int batch_size);
 Matrix *neural_network_predict(NeuralNetwork *neural_network, Matrix *X);
+Matrix *neural_network_predict_view(NeuralNetwork *neural_network, MatrixView X);
 
 #endif
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "polynomial_features.h"
 
 #include <math.h>
+#include <string.h>
 
 Matrix *polynomial_features(const Matrix *X, const int degree) {
     if (!X) {
@@ -12,19 +13,24 @@ Matrix *polynomial_features(const Matrix *X, const int degree) {
         return NULL;
     }
 
-    Matrix *pol = matrix_create(X->rows, X->cols * degree - X->cols);
+    // Row layout: [X, X^2, ..., X^degree], filled row by row straight into the result
+    Matrix *res = matrix_create(X->rows, X->cols * degree);
+    if (!res) {
+        ALLOCATION_ERROR();
+        return NULL;
+    }
 
-    int index = 0;
-    for (int p = 2; p <= degree; p++) {
-        for (int j = 0; j < X->cols; j++) {
-            for (int i = 0; i < X->rows; i++) {
-                matrix_set(pol, i, index, pow(matrix_get(X, i, j), p));
+    const int cols = X->cols;
+    for (int i = 0; i < X->rows; i++) {
+        const double *x = X->data + (size_t)i * cols;
+        double *out = res->data + (size_t)i * res->cols;
+        memcpy(out, x, sizeof(double) * cols);
+        for (int p = 2; p <= degree; p++) {
+            double *out_p = out + (size_t)(p - 1) * cols;
+            for (int j = 0; j < cols; j++) {
+                out_p[j] = pow(x[j], p);
             }
-            index++;
         }
     }
-
-    Matrix *res = matrix_concat(X, pol);
-    matrix_free(pol);
     return res;
 }
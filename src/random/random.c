@@ -1,20 +1,68 @@
 ﻿#include "random.h"
 
+#define PCG32_MULTIPLIER 6364136223846793005ULL
+
 pcg32_random_t pcg_state = {0, 0};
 
 void pcg32_seed(const uint64_t seed) {
-    pcg_state.state = seed + 0x853c49e6748fea9bULL;
-    pcg_state.inc = (seed << 1u) | 1u;
+    pcg32_seed_r(&pcg_state, seed);
 }
 
 uint32_t pcg32_random(void) {
-    const uint64_t old_state = pcg_state.state;
-    pcg_state.state = old_state * 6364136223846793005ULL + pcg_state.inc;
+    return pcg32_random_r(&pcg_state);
+}
+
+double pcg32_random_double(void) {
+    return pcg32_random_double_r(&pcg_state);
+}
+
+void pcg32_seed_r(pcg32_random_t *rng, const uint64_t seed) {
+    rng->state = seed + 0x853c49e6748fea9bULL;
+    rng->inc = (seed << 1u) | 1u;
+}
+
+void pcg32_seed_stream_r(pcg32_random_t *rng, const uint64_t seed, const uint64_t stream) {
+    // The reference PCG initialisation, the state passes through the stream's increment before the seed enters so
+    // even the first draws of different streams differ
+    rng->state = 0;
+    rng->inc = (stream << 1u) | 1u;
+    pcg32_random_r(rng);
+    rng->state += seed;
+    pcg32_random_r(rng);
+}
+
+uint32_t pcg32_random_r(pcg32_random_t *rng) {
+    const uint64_t old_state = rng->state;
+    rng->state = old_state * PCG32_MULTIPLIER + rng->inc;
     const uint32_t xor_shifted = (uint32_t)(((old_state >> 18u) ^ old_state) >> 27u);
     const uint32_t rot = (uint32_t)(old_state >> 59u);
     return (xor_shifted >> rot) | (xor_shifted << ((-rot) & 31));
 }
 
-double pcg32_random_double(void) {
-    return (double)pcg32_random() / (double)0x100000000ULL;
+double pcg32_random_double_r(pcg32_random_t *rng) {
+    return (double)pcg32_random_r(rng) / (double)0x100000000ULL;
+}
+
+void pcg32_advance_r(pcg32_random_t *rng, uint64_t delta) {
+    // Applying the LCG delta times is the affine map state * mult + plus, built by squaring the one-step map
+    uint64_t acc_mult = 1;
+    uint64_t acc_plus = 0;
+    uint64_t cur_mult = PCG32_MULTIPLIER;
+    uint64_t cur_plus = rng->inc;
+    while (delta > 0) {
+        if (delta & 1u) {
+            acc_mult *= cur_mult;
+            acc_plus = acc_plus * cur_mult + cur_plus;
+        }
+        cur_plus = (cur_mult + 1) * cur_plus;
+        cur_mult *= cur_mult;
+        delta >>= 1u;
+    }
+    rng->state = acc_mult * rng->state + acc_plus;
+}
+
+void pcg32_fill_double(pcg32_random_t *rng, double *out, const size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = pcg32_random_double_r(rng);
+    }
 }
\ No newline at end of file
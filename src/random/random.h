@@ -1,8 +1,11 @@
 ﻿#ifndef RANDOM_H
 #define RANDOM_H
 
+#include <stddef.h>
 #include <stdint.h>
 
+// A PCG32 generator. The functions ending in _r (and pcg32_fill_double) only touch the generator they are given,
+// so generators owned by different models or threads never interfere
 typedef struct {
     uint64_t state;
     uint64_t inc;
@@ -14,4 +17,16 @@ void pcg32_seed(uint64_t seed);
 uint32_t pcg32_random(void);
 double pcg32_random_double(void);
 
+// Seeds exactly as pcg32_seed does the global generator, the same seed gives the same sequence
+void pcg32_seed_r(pcg32_random_t *rng, uint64_t seed);
+// Seeds one of 2^63 streams with the reference PCG initialisation, so generators with the same seed and different
+// streams give uncorrelated sequences, e.g. one stream per worker for reproducible parallel runs
+void pcg32_seed_stream_r(pcg32_random_t *rng, uint64_t seed, uint64_t stream);
+uint32_t pcg32_random_r(pcg32_random_t *rng);
+double pcg32_random_double_r(pcg32_random_t *rng);
+// Skips delta draws in O(log delta) steps, e.g. worker k of a split sequence advancing by k times its share
+void pcg32_advance_r(pcg32_random_t *rng, uint64_t delta);
+// Writes n draws of pcg32_random_double_r into out
+void pcg32_fill_double(pcg32_random_t *rng, double *out, size_t n);
+
 #endif
\ No newline at end of file
@@ -121,9 +121,10 @@ void scaler_transform(Scaler *scaler, Matrix *X) {
 
     int n = 0;
     for (int j = scaler->col_start; j < scaler->col_end; j++) {
+        double *col = X->data + j;
         for (int i = 0; i < X->rows; i++) {
             double scaled_val = 0;
-            const double x = matrix_get(X, i, j);
+            const double x = col[(size_t)i * X->cols];
             switch (scaler->type) {
                 case MIN_MAX_NORMALIZATION: {
                     const double max = scaler->params1[n];
@@ -149,7 +150,7 @@ void scaler_transform(Scaler *scaler, Matrix *X) {
                     return;
                 }
             }
-            matrix_set(X, i, j, scaled_val);
+            col[(size_t)i * X->cols] = scaled_val;
         }
         n++;
     }
@@ -184,9 +185,10 @@ void scaler_inverse_transform(Scaler *scaler, Matrix *X) {
 
     int n = 0;
     for (int j = scaler->col_start; j < scaler->col_end; j++) {
+        double *col = X->data + j;
         for (int i = 0; i < X->rows; i++) {
             double new_val = 0;
-            const double x = matrix_get(X, i, j);
+            const double x = col[(size_t)i * X->cols];
             switch (scaler->type) {
                 case MIN_MAX_NORMALIZATION: {
                     const double max = scaler->params1[n];
@@ -211,7 +213,7 @@ void scaler_inverse_transform(Scaler *scaler, Matrix *X) {
                     return;
                 }
             }
-            matrix_set(X, i, j, new_val);
+            col[(size_t)i * X->cols] = new_val;
         }
         n++;
     }
@@ -1,7 +1,11 @@
 ﻿#include "sgdregression.h"
+#include "../coordinate_descent/coordinate_descent.h"
+#include "../gemm/gemm.h"
+#include "../minibatch/minibatch.h"
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <tgmath.h>
 #include <time.h>
 
@@ -31,7 +35,11 @@ SGDRegression *sgd_regression_create(const int number_of_features, const int fit
     sgd->fit_intercept = fit_intercept;
     sgd->number_of_features = number_of_features;
     sgd->random_seed = random_seed;
+    sgd->rng = NULL;
     sgd->penalty = penalty;
+    sgd->solver = SGD_MINIBATCH;
+    sgd->tol = 0;
+    sgd->lbfgs_history = LBFGS_DEFAULT_HISTORY;
 
     return sgd;
 }
@@ -47,192 +55,561 @@ void sgd_regression_free(SGDRegression *model) {
     free(model);
 }
 
-void sgd_regression_fit(SGDRegression *model, Matrix *X, Vector *y, const int batch, const double alpha, const int num_iters, const double lambda, const double ratio, const int print_every) {
+void sgd_regression_set_solver(SGDRegression *model, const SGDSolver solver, const double tol) {
     if (!model) {
         NULL_ERROR("SGDRegression model");
         return;
     }
-    if (!X) {
-        NULL_ERROR("Matrix");
+    if (solver != SGD_MINIBATCH && solver != SGD_LBFGS && solver != SGD_COORDINATE_DESCENT && solver != SGD_MINIBATCH_HOGWILD && solver != SGD_MINIBATCH_SYNC) {
+        CUSTOM_ERROR("Unknown solver");
         return;
     }
-    if (!y) {
-        NULL_ERROR("Vector");
+    if (tol < 0 || isnan(tol)) {
+        CUSTOM_ERROR("'tol' must be non-negative");
         return;
     }
-    if (batch <= 0 || batch > y->dim) {
-        CUSTOM_ERROR("batch must be between 1 and the number of samples");
-        return;
-    }
-    if (X->rows != y->dim || X->cols != model->number_of_features) {
-        CUSTOM_ERROR("X->rows must equal y->dim and X->cols must equal number_of_features");
+    model->solver = solver;
+    model->tol = tol;
+}
+
+void sgd_regression_set_rng(SGDRegression *model, pcg32_random_t *rng) {
+    if (!model) {
+        NULL_ERROR("SGDRegression model");
         return;
     }
+    model->rng = rng;
+}
+
+static int sgd_regression_check_parameters(const SGDRegression *model, const double alpha, const int num_iters, const double lambda, const double ratio, const int print_every) {
     if (num_iters < 1) {
         CUSTOM_ERROR("'num_iters' must be at least 1");
-        return;
+        return 0;
     }
     if (alpha < 0) {
         CUSTOM_ERROR("'alpha' must be non-negative");
-        return;
+        return 0;
     }
     if (print_every < 0) {
         CUSTOM_ERROR("'print_every' must be non-negative");
-        return;
+        return 0;
     }
 
     switch (model->penalty) {
         case NO_PENALTY: {
             if (!isnan(lambda) || !isnan(ratio)) {
                 CUSTOM_ERROR("'lambda' and 'ratio' are unused with NO_PENALTY, pass NAN");
-                return;
+                return 0;
             }
             break;
         }
         case L1_LASSO: {
             if (!isnan(ratio)) {
                 CUSTOM_ERROR("'ratio' is unused with L1_LASSO, pass NAN");
-                return;
+                return 0;
             }
             if (lambda < 0 || isnan(lambda)) {
                 CUSTOM_ERROR("'lambda' must be non-negative");
-                return;
+                return 0;
             }
             break;
         }
         case L2_RIDGE: {
             if (!isnan(ratio)) {
                 CUSTOM_ERROR("'ratio' is unused with L2_RIDGE, pass NAN");
-                return;
+                return 0;
             }
             if (lambda < 0 || isnan(lambda)) {
                 CUSTOM_ERROR("'lambda' must be non-negative");
-                return;
+                return 0;
             }
             break;
         }
         case ELASTIC_NET: {
             if (lambda < 0 || isnan(lambda)) {
                 CUSTOM_ERROR("'lambda' must be non-negative");
-                return;
+                return 0;
             }
             if (ratio < 0 || ratio > 1 || isnan(ratio)) {
                 CUSTOM_ERROR("'ratio' must be between 0 and 1");
-                return;
+                return 0;
             }
             break;
         }
     }
+    return 1;
+}
 
+// The generator of a fit: the caller's when one is set, otherwise seeded from random_seed so that every fit draws
+// the same numbers
+static pcg32_random_t *sgd_regression_rng(const SGDRegression *model, pcg32_random_t *seeded) {
+    if (model->rng) {
+        return model->rng;
+    }
     const uint64_t seed = model->random_seed < 0 ? (uint64_t)time(NULL) : (uint64_t)model->random_seed;
-    pcg32_seed(seed);
+    pcg32_seed_r(seeded, seed);
+    return seeded;
+}
 
-    const double limit = math_xavier(X->cols, 1);
+static void sgd_regression_initialize(SGDRegression *model, pcg32_random_t *rng, const double lambda, const double ratio) {
+    const double limit = math_xavier(model->number_of_features, 1);
     for (int i = 0; i < model->number_of_features; i++) {
-        const double random_w = pcg32_random_double() * 2.0 * limit - limit;
+        const double random_w = pcg32_random_double_r(rng) * 2.0 * limit - limit;
         vector_set(model->coef, i, random_w);
     }
     model->intercept = 0;
     model->lambda = lambda;
     model->ratio = ratio;
+}
+
+// Summed loss and gradient of n rows of X (row stride ldx) with targets y[i * y_stride] at the current coefficients:
+// grad receives number_of_features values and *intercept_grad the intercept's, y_hats is scratch for n. Predictions
+// and the gradient are a GEMV and a transposed GEMV over the batch
+static double sgd_regression_gradient(const void *ctx, const double *X, const int ldx, const double *y, const int y_stride, const int n, double *grad, double *intercept_grad, double *y_hats) {
+    const SGDRegression *model = ctx;
+    const int n_features = model->number_of_features;
+    double loss = 0;
+    double intercept_grad_sum = 0;
 
-    Vector *indices = vector_create(X->rows);
-    for (int i = 0; i < indices->dim; i++) {
-        vector_set(indices, i, i);
+    gemm_gemv(0, n, n_features, X, ldx, model->coef->data, y_hats);
+    const double intercept = model->fit_intercept ? model->intercept : 0.0;
+    // y_hats turns into the residuals, the weights of the transposed product
+    for (int i = 0; i < n; i++) {
+        const double error = y_hats[i] + intercept - y[(size_t)i * y_stride];
+        loss += error * error;
+        intercept_grad_sum += error;
+        y_hats[i] = error;
     }
+    gemm_gemv(1, n, n_features, X, ldx, y_hats, grad);
 
-    for (int iter = 0; iter < num_iters; iter++) {
-        vector_shuffle(indices);
-        double total_epoch_loss = 0;
+    *intercept_grad = intercept_grad_sum;
+    return loss;
+}
 
-        for (int k = 0; k < X->rows; k += batch) {
-            const int current_batch_size = k + batch > X->rows ? X->rows - k : batch;
+// Gradient step for the summed gradient of n rows, together with the penalty
+static void sgd_regression_update(void *ctx, const double *grad, const double intercept_grad, const int n, const double alpha, const double lambda, const double ratio) {
+    SGDRegression *model = ctx;
+    double *w = model->coef->data;
+    for (int j = 0; j < model->number_of_features; j++) {
+        const double grad_j = grad[j] / n;
+        double w_j = w[j];
 
-            Vector *grad_sums = vector_create(model->number_of_features);
-            double intercept_grad_sum = 0;
+        switch (model->penalty) {
+            case L2_RIDGE:
+                w_j -= alpha * (grad_j + lambda * w_j);
+                break;
+            case L1_LASSO:
+                w_j -= alpha * (grad_j + lambda * (w_j > 0 ? 1 : -1));
+                break;
+            case ELASTIC_NET: {
+                const double l1 = ratio * (w_j > 0 ? 1 : -1);
+                const double l2 = (1.0 - ratio) * w_j;
+                w_j -= alpha * (grad_j + lambda * (l1 + l2));
+                break;
+            }
+            default:
+                w_j -= alpha * grad_j;
+                break;
+        }
+        w[j] = w_j;
+    }
 
-            for (int i = 0; i < current_batch_size; i++) {
-                const int row_idx = (int)vector_get(indices, k + i);
+    if (model->fit_intercept) {
+        model->intercept -= alpha * (intercept_grad / n);
+    }
+}
 
-                double y_hat = 0;
-                for (int j = 0; j < model->number_of_features; j++) {
-                    y_hat += matrix_get(X, row_idx, j) * vector_get(model->coef, j);
-                }
-                if (model->fit_intercept) {
-                    y_hat += model->intercept;
-                }
+// One minibatch update, see sgd_regression_gradient. Returns the summed loss of the batch before the update
+static double sgd_regression_step(SGDRegression *model, const double *X, const int ldx, const double *y, const int y_stride, const int n, double *grad, double *y_hats, const double alpha, const double lambda, const double ratio) {
+    double intercept_grad;
+    const double loss = sgd_regression_gradient(model, X, ldx, y, y_stride, n, grad, &intercept_grad, y_hats);
+    sgd_regression_update(model, grad, intercept_grad, n, alpha, lambda, ratio);
+    return loss;
+}
 
-                const double error = y_hat - vector_get(y, row_idx);
-                total_epoch_loss += error * error;
+typedef struct {
+    const SGDRegression *model;
+    MatrixView X;
+    VectorView y;
+    double ridge;
+    double *row_buf;
+} SGDLbfgsTask;
 
-                for (int j = 0; j < model->number_of_features; j++) {
-                    vector_set(grad_sums, j, vector_get(grad_sums, j) + error * matrix_get(X, row_idx, j));
-                }
-                intercept_grad_sum += error;
-            }
+// Half the mean squared error + ridge / 2 * ||w||^2 over the parameters [w, intercept], the objective the
+// minibatch steps follow
+static double sgd_regression_lbfgs_objective(void *ctx, const double *params, double *grad) {
+    const SGDLbfgsTask *t = ctx;
+    const int n_features = t->model->number_of_features;
+    const int fit_intercept = t->model->fit_intercept;
+    const double intercept = fit_intercept ? params[n_features] : 0.0;
+    memset(grad, 0, sizeof(double) * (n_features + fit_intercept));
 
-            for (int j = 0; j < model->number_of_features; j++) {
-                const double grad_j = vector_get(grad_sums, j) / current_batch_size;
-                double w_j = vector_get(model->coef, j);
-
-                switch (model->penalty) {
-                    case L2_RIDGE:
-                        w_j -= alpha * (grad_j + lambda * w_j);
-                        break;
-                    case L1_LASSO:
-                        w_j -= alpha * (grad_j + lambda * (w_j > 0 ? 1 : -1));
-                        break;
-                    case ELASTIC_NET: {
-                        const double l1 = ratio * (w_j > 0 ? 1 : -1);
-                        const double l2 = (1.0 - ratio) * w_j;
-                        w_j -= alpha * (grad_j + lambda * (l1 + l2));
-                        break;
-                    }
-                    default:
-                        w_j -= alpha * grad_j;
-                        break;
-                }
-                vector_set(model->coef, j, w_j);
-            }
+    double loss = 0;
+    for (int i = 0; i < t->X.rows; i++) {
+        const double *x = matrix_view_row(t->X, i, t->row_buf);
+        double y_hat = intercept;
+        for (int j = 0; j < n_features; j++) {
+            y_hat += x[j] * params[j];
+        }
+        const double error = y_hat - vector_view_get(t->y, i);
+        loss += error * error;
 
-            if (model->fit_intercept) {
-                model->intercept -= alpha * (intercept_grad_sum / current_batch_size);
-            }
-            vector_free(grad_sums);
+        for (int j = 0; j < n_features; j++) {
+            grad[j] += error * x[j];
+        }
+        if (fit_intercept) {
+            grad[n_features] += error;
+        }
+    }
+
+    const double inv_n = 1.0 / t->X.rows;
+    double norm = 0;
+    for (int j = 0; j < n_features + fit_intercept; j++) {
+        grad[j] *= inv_n;
+    }
+    for (int j = 0; j < n_features; j++) {
+        grad[j] += t->ridge * params[j];
+        norm += params[j] * params[j];
+    }
+    return 0.5 * loss * inv_n + 0.5 * t->ridge * norm;
+}
+
+// Starts from zero weights, the random initialization only matters to the minibatch path
+static void sgd_regression_fit_lbfgs(SGDRegression *model, const MatrixView X, const VectorView y, const int num_iters, const double lambda, const int print_every) {
+    const int n_features = model->number_of_features;
+    const int n_params = n_features + model->fit_intercept;
+    double *params = calloc(n_params, sizeof(double));
+    double *row_buf = malloc(sizeof(double) * n_features);
+    if (!params || !row_buf) {
+        ALLOCATION_ERROR();
+        free(params);
+        free(row_buf);
+        return;
+    }
+
+    SGDLbfgsTask task = {model, X, y, model->penalty == L2_RIDGE ? lambda : 0.0, row_buf};
+    const LbfgsOptions options = {model->lbfgs_history, num_iters, model->tol, print_every};
+    if (lbfgs_minimize(sgd_regression_lbfgs_objective, &task, n_params, params, &options) >= 0) {
+        memcpy(model->coef->data, params, sizeof(double) * n_features);
+        model->intercept = model->fit_intercept ? params[n_features] : 0.0;
+    }
+    free(params);
+    free(row_buf);
+}
+
+// Share of the penalty that is L1, in the form coordinate_descent_solve takes
+static double sgd_regression_l1_ratio(const SGDRegression *model, const double ratio) {
+    switch (model->penalty) {
+        case L1_LASSO:
+            return 1.0;
+        case ELASTIC_NET:
+            return ratio;
+        default:
+            return 0.0;
+    }
+}
+
+// Fits every lambda of the grid in turn, from zero coefficients. coefs and intercepts (may be NULL) receive one row
+// and one value per lambda
+static void sgd_regression_coordinate_descent(SGDRegression *model, const MatrixView X, const VectorView y, const double *lambdas, const int num_lambdas, const double ratio, const int max_sweeps, const int print_every, Matrix *coefs, Vector *intercepts) {
+    const int n_features = model->number_of_features;
+    const int n_samples = X.rows;
+    double *Q = calloc((size_t)n_features * n_features, sizeof(double));
+    double *c = calloc(n_features, sizeof(double));
+    double *x_mean = calloc(n_features, sizeof(double));
+    double *Qw = calloc(n_features, sizeof(double));
+    if (!Q || !c || !x_mean || !Qw) {
+        ALLOCATION_ERROR();
+        free(Q);
+        free(c);
+        free(x_mean);
+        free(Qw);
+        return;
+    }
+
+    // Q = X^T X / n and c = X^T y / n, centered when fitting the intercept so that it drops out of the problem
+    gemm_syrk(n_features, n_samples, X.data, X.row_stride, X.col_stride, y.data, y.stride, Q, n_features,
+              model->fit_intercept ? x_mean : NULL, c);
+    double y_mean = 0;
+    if (model->fit_intercept) {
+        for (int i = 0; i < n_samples; i++) {
+            y_mean += vector_view_get(y, i);
+        }
+        y_mean /= n_samples;
+        for (int j = 0; j < n_features; j++) {
+            x_mean[j] /= n_samples;
         }
+    }
+    for (int j = 0; j < n_features; j++) {
+        double *q_j = Q + (size_t)j * n_features;
+        for (int k = j; k < n_features; k++) {
+            q_j[k] = q_j[k] / n_samples - x_mean[j] * x_mean[k];
+            Q[(size_t)k * n_features + j] = q_j[k];
+        }
+        c[j] = c[j] / n_samples - x_mean[j] * y_mean;
+    }
+
+    const double l1_ratio = sgd_regression_l1_ratio(model, ratio);
+    double *w = model->coef->data;
+    memset(w, 0, sizeof(double) * n_features);
+    double lambda_prev = coordinate_descent_lambda_max(c, n_features, l1_ratio);
 
-        if (print_every > 0 && (iter % print_every == 0 || iter == num_iters - 1)) {
-            printf("Epoch: %d | Cost (MSE): [%lf]\n", iter + 1, total_epoch_loss / (2.0 * X->rows));
+    for (int k = 0; k < num_lambdas; k++) {
+        const double lambda = model->penalty == NO_PENALTY ? 0.0 : lambdas[k];
+        const int sweeps = coordinate_descent_solve(Q, n_features, n_features, c, lambda, l1_ratio, lambda_prev, model->tol, max_sweeps, w, Qw);
+        lambda_prev = lambda;
+
+        double intercept = y_mean;
+        int nonzero = 0;
+        for (int j = 0; j < n_features; j++) {
+            intercept -= x_mean[j] * w[j];
+            nonzero += w[j] != 0.0;
+        }
+        model->intercept = model->fit_intercept ? intercept : 0.0;
+        if (coefs) {
+            memcpy(coefs->data + (size_t)k * n_features, w, sizeof(double) * n_features);
+        }
+        if (intercepts) {
+            intercepts->data[k] = model->intercept;
+        }
+        if (print_every > 0 && (k % print_every == 0 || k == num_lambdas - 1)) {
+            printf("Lambda: %lf | Sweeps: %d | Nonzero: %d\n", lambda, sweeps, nonzero);
         }
     }
-    vector_free(indices);
+
+    free(Q);
+    free(c);
+    free(x_mean);
+    free(Qw);
 }
 
-Vector *sgd_regression_predict(SGDRegression *model, Matrix *X) {
+void sgd_regression_fit(SGDRegression *model, Matrix *X, Vector *y, const int batch, const double alpha, const int num_iters, const double lambda, const double ratio, const int print_every) {
+    if (!X) {
+        NULL_ERROR("Matrix");
+        return;
+    }
+    if (!y) {
+        NULL_ERROR("Vector");
+        return;
+    }
+    sgd_regression_fit_view(model, matrix_view(X), vector_view(y), batch, alpha, num_iters, lambda, ratio, print_every);
+}
+
+void sgd_regression_fit_view(SGDRegression *model, const MatrixView X, const VectorView y, const int batch, const double alpha, const int num_iters, const double lambda, const double ratio, const int print_every) {
+    if (!model) {
+        NULL_ERROR("SGDRegression model");
+        return;
+    }
+    if (!X.data || !y.data) {
+        NULL_ERROR("View");
+        return;
+    }
+    if (batch <= 0 || batch > y.dim) {
+        CUSTOM_ERROR("batch must be between 1 and the number of samples");
+        return;
+    }
+    if (X.rows != y.dim || X.cols != model->number_of_features) {
+        CUSTOM_ERROR("X.rows must equal y.dim and X.cols must equal number_of_features");
+        return;
+    }
+    if (!sgd_regression_check_parameters(model, alpha, num_iters, lambda, ratio, print_every)) {
+        return;
+    }
+    if (model->solver == SGD_COORDINATE_DESCENT) {
+        model->lambda = lambda;
+        model->ratio = ratio;
+        sgd_regression_coordinate_descent(model, X, y, &lambda, 1, ratio, num_iters, print_every, NULL, NULL);
+        return;
+    }
+    if (model->solver == SGD_LBFGS) {
+        if (model->penalty != NO_PENALTY && model->penalty != L2_RIDGE) {
+            CUSTOM_ERROR("The L-BFGS solver supports NO_PENALTY and L2_RIDGE only");
+            return;
+        }
+        model->lambda = lambda;
+        model->ratio = ratio;
+        sgd_regression_fit_lbfgs(model, X, y, num_iters, lambda, print_every);
+        return;
+    }
+    pcg32_random_t seeded;
+    pcg32_random_t *rng = sgd_regression_rng(model, &seeded);
+    sgd_regression_initialize(model, rng, lambda, ratio);
+
+    const MinibatchModel minibatch_model = {model, model->number_of_features, sgd_regression_gradient, sgd_regression_update};
+    const MinibatchSchedule schedule = model->solver == SGD_MINIBATCH_HOGWILD ? MINIBATCH_HOGWILD : model->solver == SGD_MINIBATCH_SYNC ? MINIBATCH_SYNC : MINIBATCH_SERIAL;
+    MinibatchTrainer trainer;
+    if (!minibatch_init(&trainer, minibatch_model, schedule, rng, X, y, batch, alpha, lambda, ratio)) {
+        return;
+    }
+
+    double previous_loss = 0;
+    for (int iter = 0; iter < num_iters; iter++) {
+        const double total_epoch_loss = minibatch_epoch(&trainer);
+
+        const double epoch_loss = total_epoch_loss / (2.0 * X.rows);
+        const int converged = model->tol > 0 && iter > 0 && fabs(previous_loss - epoch_loss) <= model->tol * previous_loss;
+        if (print_every > 0 && (iter % print_every == 0 || iter == num_iters - 1 || converged)) {
+            printf("Epoch: %d | Cost (MSE): [%lf]\n", iter + 1, epoch_loss);
+        }
+        if (converged) {
+            break;
+        }
+        previous_loss = epoch_loss;
+    }
+    minibatch_free(&trainer);
+}
+
+void sgd_regression_fit_stream(SGDRegression *model, CsvStream *stream, const int batch, const double alpha, const int num_iters, const double lambda, const double ratio, const int print_every) {
+    if (!model) {
+        NULL_ERROR("SGDRegression model");
+        return;
+    }
+    if (!stream) {
+        NULL_ERROR("CsvStream");
+        return;
+    }
+    if (stream->cols != model->number_of_features + 1) {
+        CUSTOM_ERROR("Stream must have number_of_features + 1 columns (features, then the target)");
+        return;
+    }
+    if (batch < 1) {
+        CUSTOM_ERROR("'batch' must be at least 1");
+        return;
+    }
+    if (!sgd_regression_check_parameters(model, alpha, num_iters, lambda, ratio, print_every)) {
+        return;
+    }
+    if (model->solver != SGD_MINIBATCH) {
+        CUSTOM_ERROR("Streams are trained with SGD_MINIBATCH only");
+        return;
+    }
+
+    Matrix *rows = matrix_create(batch, stream->cols);
+    Vector *grad_sums = vector_create(model->number_of_features);
+    Vector *y_hats = vector_create(batch);
+    if (!rows || !grad_sums || !y_hats) {
+        ALLOCATION_ERROR();
+        if (rows) matrix_free(rows);
+        if (grad_sums) vector_free(grad_sums);
+        if (y_hats) vector_free(y_hats);
+        return;
+    }
+    pcg32_random_t seeded;
+    sgd_regression_initialize(model, sgd_regression_rng(model, &seeded), lambda, ratio);
+
+    double previous_loss = 0;
+    for (int iter = 0; iter < num_iters; iter++) {
+        csv_stream_rewind(stream);
+        double total_epoch_loss = 0;
+        long long seen = 0;
+
+        int n;
+        while ((n = csv_stream_next_batch(stream, rows, batch)) > 0) {
+            total_epoch_loss += sgd_regression_step(model, rows->data, rows->cols, rows->data + model->number_of_features, rows->cols, n, grad_sums->data, y_hats->data, alpha, lambda, ratio);
+            seen += n;
+        }
+
+        const double epoch_loss = total_epoch_loss / (2.0 * (double)seen);
+        const int converged = model->tol > 0 && iter > 0 && fabs(previous_loss - epoch_loss) <= model->tol * previous_loss;
+        if (print_every > 0 && (iter % print_every == 0 || iter == num_iters - 1 || converged)) {
+            printf("Epoch: %d | Cost (MSE): [%lf]\n", iter + 1, epoch_loss);
+        }
+        if (converged) {
+            break;
+        }
+        previous_loss = epoch_loss;
+    }
+    matrix_free(rows);
+    vector_free(grad_sums);
+    vector_free(y_hats);
+}
+
+Matrix *sgd_regression_path(SGDRegression *model, const MatrixView X, const VectorView y, const double *lambdas, const int num_lambdas, const double ratio, const int num_iters, Vector **intercepts) {
     if (!model) {
         NULL_ERROR("SGDRegression model");
         return NULL;
     }
+    if (!X.data || !y.data || !lambdas) {
+        NULL_ERROR("View or lambdas");
+        return NULL;
+    }
+    if (X.rows != y.dim || X.cols != model->number_of_features) {
+        CUSTOM_ERROR("X.rows must equal y.dim and X.cols must equal number_of_features");
+        return NULL;
+    }
+    if (model->penalty == NO_PENALTY) {
+        CUSTOM_ERROR("A regularization path needs a penalty");
+        return NULL;
+    }
+    if (num_lambdas < 1) {
+        CUSTOM_ERROR("'num_lambdas' must be at least 1");
+        return NULL;
+    }
+    for (int k = 0; k < num_lambdas; k++) {
+        if (!sgd_regression_check_parameters(model, 0, num_iters, lambdas[k], ratio, 0)) {
+            return NULL;
+        }
+        if (k > 0 && lambdas[k] > lambdas[k - 1]) {
+            CUSTOM_ERROR("'lambdas' must be in descending order");
+            return NULL;
+        }
+    }
+
+    Matrix *coefs = matrix_create(num_lambdas, model->number_of_features);
+    Vector *path_intercepts = intercepts ? vector_create(num_lambdas) : NULL;
+    if (!coefs || (intercepts && !path_intercepts)) {
+        ALLOCATION_ERROR();
+        if (coefs) matrix_free(coefs);
+        if (path_intercepts) vector_free(path_intercepts);
+        return NULL;
+    }
+    model->lambda = lambdas[num_lambdas - 1];
+    model->ratio = ratio;
+    sgd_regression_coordinate_descent(model, X, y, lambdas, num_lambdas, ratio, num_iters, 0, coefs, path_intercepts);
+    if (intercepts) {
+        *intercepts = path_intercepts;
+    }
+    return coefs;
+}
+
+Vector *sgd_regression_predict(SGDRegression *model, Matrix *X) {
     if (!X) {
         NULL_ERROR("Matrix");
         return NULL;
     }
-    if (X->cols != model->number_of_features) {
+    return sgd_regression_predict_view(model, matrix_view(X));
+}
+
+Vector *sgd_regression_predict_view(SGDRegression *model, const MatrixView X) {
+    if (!model) {
+        NULL_ERROR("SGDRegression model");
+        return NULL;
+    }
+    if (!X.data) {
+        NULL_ERROR("MatrixView");
+        return NULL;
+    }
+    if (X.cols != model->number_of_features) {
         CUSTOM_ERROR("X->cols must equal number_of_features");
         return NULL;
     }
 
-    Vector *res = vector_create(X->rows);
+    Vector *res = vector_create(X.rows);
+    double *row_buf = malloc(sizeof(double) * X.cols);
+    if (!res || !row_buf) {
+        ALLOCATION_ERROR();
+        if (res) vector_free(res);
+        free(row_buf);
+        return NULL;
+    }
+    const double *w = model->coef->data;
     for (int i = 0; i < res->dim; i++) {
+        const double *x = matrix_view_row(X, i, row_buf);
         double dot = 0;
         for (int j = 0; j < model->coef->dim; j++) {
-            dot += vector_get(model->coef, j) * matrix_get(X, i, j);
-        }
-        if (model->fit_intercept == 1) {
-            vector_set(res, i, dot + model->intercept);
-        } else {
-            vector_set(res, i, dot);
+            dot += w[j] * x[j];
         }
+        res->data[i] = model->fit_intercept == 1 ? dot + model->intercept : dot;
     }
+    free(row_buf);
     return res;
 }
\ No newline at end of file
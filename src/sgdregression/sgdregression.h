@@ -1,11 +1,21 @@
 ﻿#ifndef SGDREGRESSION_H
 #define SGDREGRESSION_H
 
+#include "../csv/csv.h"
+#include "../lbfgs/lbfgs.h"
 #include "../matrix/matrix.h"
 #include "../math_functions/math_functions.h"
 #include "../penalty_types/penalty_types.h"
 #include "../random/random.h"
 
+typedef enum {
+    SGD_MINIBATCH,
+    SGD_LBFGS,
+    SGD_COORDINATE_DESCENT,
+    SGD_MINIBATCH_HOGWILD,
+    SGD_MINIBATCH_SYNC
+} SGDSolver;
+
 typedef struct {
     Vector *coef;
     double intercept;
@@ -14,13 +24,42 @@ typedef struct {
     int fit_intercept;
     int number_of_features;
     int random_seed;
+    pcg32_random_t *rng;
     Penalty penalty;
+    SGDSolver solver;
+    double tol;
+    int lbfgs_history;
 } SGDRegression;
 
 SGDRegression *sgd_regression_create(int number_of_features, int fit_intercept, int random_seed, Penalty penalty);
 void sgd_regression_free(SGDRegression *model);
+// SGD_MINIBATCH (the default) trains on minibatches with a fixed alpha. SGD_LBFGS minimises the same half mean
+// squared error with full-batch L-BFGS iterations keeping lbfgs_history pairs (LBFGS_DEFAULT_HISTORY unless
+// changed), ignoring batch and alpha, and supports NO_PENALTY and L2_RIDGE only. SGD_COORDINATE_DESCENT solves it
+// for any penalty with exact zeros, see sgd_regression_path, num_iters capping the sweeps. With tol > 0 minibatch
+// training stops once the epoch loss changes by at most tol relative to the previous epoch, L-BFGS as lbfgs_minimize
+// does and coordinate descent as coordinate_descent_solve does; with tol = 0 (the default) minibatch training runs
+// all num_iters and coordinate descent runs until no coefficient moves. SGD_MINIBATCH_HOGWILD and SGD_MINIBATCH_SYNC
+// spread minibatch training over the global thread pool: Hogwild gives every thread a shard of the rows and lets it
+// update the coefficients without locks (fastest, not reproducible with more than one thread), the synchronous mode
+// splits each batch across the threads and sums their gradients before one update (reproducible for a given thread
+// count, and identical to SGD_MINIBATCH on a single thread)
+void sgd_regression_set_solver(SGDRegression *model, SGDSolver solver, double tol);
+// Draws the initial coefficients and the shuffles from rng, a caller-owned generator that advances across fits,
+// instead of a generator seeded with random_seed at every fit. NULL goes back to random_seed
+void sgd_regression_set_rng(SGDRegression *model, pcg32_random_t *rng);
 
 void sgd_regression_fit(SGDRegression *model, Matrix *X, Vector *y, int batch, double alpha, int num_iters, double lambda, double ratio, int print_every);
+void sgd_regression_fit_view(SGDRegression *model, MatrixView X, VectorView y, int batch, double alpha, int num_iters, double lambda, double ratio, int print_every);
+// Trains from a stream whose rows are the features followed by the target, rewinding it every epoch.
+// Batches follow file order, there is no shuffling
+void sgd_regression_fit_stream(SGDRegression *model, CsvStream *stream, int batch, double alpha, int num_iters, double lambda, double ratio, int print_every);
+// Coordinate descent over a descending lambda grid from one pass over the data (X^T X and X^T y, centered when fitting
+// the intercept), each fit warm-starting the next. ratio follows the penalty as in the fit functions. Returns the
+// num_lambdas x number_of_features coefficients, intercepts (may be NULL) receives one intercept per lambda and
+// the model is left fitted at the last lambda
+Matrix *sgd_regression_path(SGDRegression *model, MatrixView X, VectorView y, const double *lambdas, int num_lambdas, double ratio, int num_iters, Vector **intercepts);
 Vector *sgd_regression_predict(SGDRegression *model, Matrix *X);
+Vector *sgd_regression_predict_view(SGDRegression *model, MatrixView X);
 
 #endif
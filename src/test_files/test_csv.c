@@ -0,0 +1,79 @@
+// Import the necessary packages
+#include <float.h>
+#include <stdio.h>
+#include "../csv/csv.h"
+#include "../matrix/matrix.h"
+#include "../matrix_io/matrix_io.h"
+#include "../random/random.h"
+#include "../thread_pool/thread_pool.h"
+
+static int same_matrix(const Matrix *A, const Matrix *B) {
+    if (!A || !B || A->rows != B->rows || A->cols != B->cols) {
+        return 0;
+    }
+    for (int i = 0; i < A->rows; i++) {
+        for (int j = 0; j < A->cols; j++) {
+            if (matrix_get(A, i, j) != matrix_get(B, i, j)) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+void test_csv() {
+    // Format every value and parse it back, subnormals and the extremes included
+    const double values[] = {0.1, 1.0 / 3.0, -2.5e-300, 123456789.125, 1e-310, 5e-324, DBL_MIN, DBL_MAX, 0.0};
+    char text[CSV_DOUBLE_CHARS];
+    for (int i = 0; i < (int)(sizeof(values) / sizeof(values[0])); i++) {
+        const int length = csv_format_double(values[i], text);
+        const char *stop;
+        const double parsed = csv_parse_double(text, text + length, &stop);
+        printf("Value: %-24s | Round trip: %s\n", text, parsed == values[i] && stop == text + length ? "OK" : "MISMATCH");
+    }
+
+    // Write a file large enough to be parsed in parallel chunks (about 6 MB)
+    Matrix *X = matrix_create(40000, 8);
+    pcg32_seed(42);
+    for (int i = 0; i < X->rows; i++) {
+        for (int j = 0; j < X->cols; j++) {
+            matrix_set(X, i, j, pcg32_random_double() * 2000 - 1000);
+        }
+    }
+    matrix_write_csv(X, "csv_check.csv", ',', NULL);
+
+    // Read it serially and with 4 threads, both must give back X exactly
+    clearn_set_num_threads(1);
+    Matrix *serial = csv_read("csv_check.csv", ',', 0);
+    clearn_set_num_threads(4);
+    Matrix *parallel = csv_read("csv_check.csv", ',', 0);
+    clearn_set_num_threads(1);
+    printf("Serial csv_read: %s | Parallel csv_read: %s\n", same_matrix(X, serial) ? "OK" : "MISMATCH", same_matrix(X, parallel) ? "OK" : "MISMATCH");
+
+    // Stream the file in batches, rewind and stream it again, both passes must see the same rows
+    CsvStream *stream = csv_stream_open("csv_check.csv", ',', 0);
+    Matrix *batch = matrix_create(1000, X->cols);
+    int passes_match = 1;
+    for (int pass = 0; pass < 2; pass++) {
+        int row = 0, rows;
+        while ((rows = csv_stream_next_batch(stream, batch, batch->rows)) > 0) {
+            for (int i = 0; i < rows; i++) {
+                for (int j = 0; j < X->cols; j++) {
+                    if (row + i >= X->rows || matrix_get(batch, i, j) != matrix_get(X, row + i, j)) passes_match = 0;
+                }
+            }
+            row += rows;
+        }
+        if (row != X->rows) passes_match = 0;
+        csv_stream_rewind(stream);
+    }
+    printf("Stream after rewind: %s\n", passes_match ? "OK" : "MISMATCH");
+
+    // Cleanup
+    csv_stream_close(stream);
+    remove("csv_check.csv");
+    matrix_free(X);
+    matrix_free(serial);
+    matrix_free(parallel);
+    matrix_free(batch);
+}
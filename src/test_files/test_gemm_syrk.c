@@ -0,0 +1,44 @@
+// Import the necessary packages
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../gemm/gemm.h"
+#include "../random/random.h"
+
+void test_gemm_syrk() {
+    // A 3 x 4100 operand, wider than one column block of the packed kernel
+    const int n = 4100, k = 3;
+    double *A = malloc(sizeof(double) * k * n);
+    double y[3] = {1.5, -2.0, 0.25};
+    pcg32_random_t rng;
+    pcg32_seed_r(&rng, 42);
+    pcg32_fill_double(&rng, A, (size_t)k * n);
+
+    // Gram matrix, column sums and A^T y in one pass
+    double *C = calloc((size_t)n * n, sizeof(double));
+    double *sums = calloc(n, sizeof(double));
+    double *Aty = calloc(n, sizeof(double));
+    gemm_syrk(n, k, A, n, 1, y, 1, C, n, sums, Aty);
+
+    // Compare every column, the last ones included, with plain loops
+    double max_diff = 0;
+    for (int j = 0; j < n; j++) {
+        double sum = 0, dot = 0, square = 0;
+        for (int p = 0; p < k; p++) {
+            sum += A[p * n + j];
+            dot += A[p * n + j] * y[p];
+            square += A[p * n + j] * A[p * n + j];
+        }
+        max_diff = fmax(max_diff, fabs(sums[j] - sum));
+        max_diff = fmax(max_diff, fabs(Aty[j] - dot));
+        max_diff = fmax(max_diff, fabs(C[(size_t)j * n + j] - square));
+    }
+    printf("Column %d | Sum: %.6f | A^T y: %.6f\n", n - 1, sums[n - 1], Aty[n - 1]);
+    printf("gemm_syrk sums, A^T y and diagonal for n = %d: %s\n", n, max_diff < 1e-12 ? "OK" : "MISMATCH");
+
+    // Cleanup
+    free(A);
+    free(C);
+    free(sums);
+    free(Aty);
+}
@@ -0,0 +1,42 @@
+// Import the necessary packages
+#include <math.h>
+#include <stdio.h>
+#include "../matrix/matrix.h"
+#include "../scaler/scaler.h"
+#include "../sgdregression/sgdregression.h"
+
+void test_lasso_path() {
+    // Load dataset from CSV and standardize the feature columns
+    Matrix *df = read_csv("apartments.csv", ',', 1);
+    Scaler *scaler = scaler_create(STANDARDIZATION, 0, df->cols - 1);
+    scaler_fit_transform(scaler, df);
+    MatrixView X = matrix_view_slice(df, 0, df->rows, 0, df->cols - 1);
+    VectorView y = matrix_view_col(matrix_view(df), df->cols - 1);
+
+    // Lasso path over a descending lambda grid, from one that removes every feature down to a light penalty
+    const double lambdas[] = {100000, 30000, 10000, 3000, 1000, 100};
+    SGDRegression *model = sgd_regression_create(X.cols, 1, 42, L1_LASSO);
+    Vector *intercepts = NULL;
+    Matrix *coefs = sgd_regression_path(model, X, y, lambdas, 6, NAN, 1000, &intercepts);
+
+    // Strong penalties must leave exact zeros, and fewer of them as lambda decreases
+    int zeros_found = 0;
+    for (int k = 0; k < coefs->rows; k++) {
+        int zeros = 0;
+        printf("Lambda: %-8.0f | Intercept: %.2f | Coefficients:", lambdas[k], vector_get(intercepts, k));
+        for (int j = 0; j < coefs->cols; j++) {
+            printf(" %.2f", matrix_get(coefs, k, j));
+            if (matrix_get(coefs, k, j) == 0.0) zeros++;
+        }
+        printf(" | Exact zeros: %d\n", zeros);
+        if (zeros > 0) zeros_found = 1;
+    }
+    printf("Lasso path gives exact zeros: %s\n", zeros_found ? "OK" : "MISMATCH");
+
+    // Cleanup
+    matrix_free(df);
+    matrix_free(coefs);
+    vector_free(intercepts);
+    scaler_free(scaler);
+    sgd_regression_free(model);
+}
@@ -0,0 +1,47 @@
+// Import the necessary packages
+#include <math.h>
+#include <stdio.h>
+#include "../logistic_regression/logistic_regression.h"
+#include "../matrix/matrix.h"
+#include "../scaler/scaler.h"
+
+void test_logistic_solvers() {
+    // Load dataset from CSV and standardize the feature columns
+    Matrix *df = read_csv("loan_approval.csv", ',', 1);
+    Scaler *scaler = scaler_create(STANDARDIZATION, 0, df->cols - 1);
+    scaler_fit_transform(scaler, df);
+    MatrixView X = matrix_view_slice(df, 0, df->rows, 0, df->cols - 1);
+    VectorView y = matrix_view_col(matrix_view(df), df->cols - 1);
+
+    // Fit the same L2 problem (lambda = 0.1) with Newton, L-BFGS and coordinate descent
+    const LogisticSolver solvers[] = {LOGISTIC_NEWTON, LOGISTIC_LBFGS, LOGISTIC_COORDINATE_DESCENT};
+    const char *names[] = {"Newton", "L-BFGS", "Coordinate descent"};
+    LogisticRegression *models[3];
+    for (int s = 0; s < 3; s++) {
+        models[s] = logistic_regression_create(X.cols, 1, 42, 0.5, L2_RIDGE);
+        logistic_regression_set_solver(models[s], solvers[s], 1e-12);
+        logistic_regression_fit_view(models[s], X, y, 32, 0.1, 200, 0.1, NAN, 0);
+        printf("%-18s | Intercept: %.6f | Coefficients:", names[s], models[s]->intercept);
+        for (int j = 0; j < X.cols; j++) {
+            printf(" %.6f", vector_get(models[s]->coef, j));
+        }
+        printf("\n");
+    }
+
+    // The three solvers minimise the same objective, so their coefficients must agree closely
+    double max_diff = 0;
+    for (int s = 1; s < 3; s++) {
+        max_diff = fmax(max_diff, fabs(models[s]->intercept - models[0]->intercept));
+        for (int j = 0; j < X.cols; j++) {
+            max_diff = fmax(max_diff, fabs(vector_get(models[s]->coef, j) - vector_get(models[0]->coef, j)));
+        }
+    }
+    printf("Newton, L-BFGS and coordinate descent agree: %s (max difference %.2e)\n", max_diff < 1e-4 ? "OK" : "MISMATCH", max_diff);
+
+    // Cleanup
+    matrix_free(df);
+    scaler_free(scaler);
+    for (int s = 0; s < 3; s++) {
+        logistic_regression_free(models[s]);
+    }
+}
@@ -0,0 +1,41 @@
+// Import the necessary packages
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../matrix/matrix.h"
+#include "../matrix_io/matrix_io.h"
+
+void test_matrix_io() {
+    // Create a small matrix with named columns
+    Matrix *X = matrix_create(4, 3);
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 3; j++) {
+            matrix_set(X, i, j, (i * 3 + j) / 7.0); // values that are not exact in decimal
+        }
+    }
+    const char *const names[] = {"area", "rooms", "price"};
+
+    // Save it in the binary format and map it back
+    matrix_save_bin(X, "matrix_check.clbin", names);
+    char **loaded_names = NULL;
+    Matrix *loaded = matrix_load_bin("matrix_check.clbin", &loaded_names);
+
+    // Every value and column name must come back unchanged
+    int same = loaded && loaded->rows == X->rows && loaded->cols == X->cols && loaded_names;
+    for (int i = 0; same && i < X->rows; i++) {
+        for (int j = 0; j < X->cols; j++) {
+            if (matrix_get(loaded, i, j) != matrix_get(X, i, j)) same = 0;
+        }
+    }
+    for (int j = 0; same && j < X->cols; j++) {
+        if (strcmp(loaded_names[j], names[j]) != 0) same = 0;
+    }
+    printf("save_bin / load_bin: %s\n", same ? "OK" : "MISMATCH");
+    matrix_print(loaded);
+
+    // Cleanup
+    matrix_free(X);
+    matrix_free(loaded);
+    free(loaded_names);
+    remove("matrix_check.clbin");
+}
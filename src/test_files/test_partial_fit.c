@@ -0,0 +1,40 @@
+// Import the necessary packages
+#include <math.h>
+#include <stdio.h>
+#include "../linear_regression/linear_regression.h"
+#include "../matrix/matrix.h"
+
+void test_partial_fit() {
+    // Load dataset from CSV
+    Matrix *df = read_csv("apartments.csv", ',', 1);
+    MatrixView X = matrix_view_slice(df, 0, df->rows, 0, df->cols - 1);
+    VectorView y = matrix_view_col(matrix_view(df), df->cols - 1);
+
+    // Fit on every row at once
+    LinearRegression *full = linear_regression_create(X.cols, 1);
+    linear_regression_fit_view(full, X, y, 0.01);
+
+    // Accumulate the first 60 rows and the rest in two models, as if on two shards, then merge and solve
+    LinearRegression *first = linear_regression_create(X.cols, 1);
+    LinearRegression *second = linear_regression_create(X.cols, 1);
+    linear_regression_partial_fit_view(first, matrix_view_slice(df, 0, 60, 0, df->cols - 1), matrix_view_col(matrix_view_rows(df, 0, 60), df->cols - 1));
+    linear_regression_partial_fit_view(second, matrix_view_slice(df, 60, df->rows, 0, df->cols - 1), matrix_view_col(matrix_view_rows(df, 60, df->rows), df->cols - 1));
+    linear_regression_merge(first, second);
+    linear_regression_finalize(first, 0.01);
+
+    // Both must give the same coefficients up to rounding
+    double max_diff = fabs(first->intercept - full->intercept) / fmax(fabs(full->intercept), 1.0);
+    for (int j = 0; j < X.cols; j++) {
+        const double diff = fabs(vector_get(first->coef, j) - vector_get(full->coef, j)) / fmax(fabs(vector_get(full->coef, j)), 1.0);
+        printf("Coefficient %d | fit: %.10g | partial_fit + merge: %.10g\n", j, vector_get(full->coef, j), vector_get(first->coef, j));
+        if (diff > max_diff) max_diff = diff;
+    }
+    printf("Intercept | fit: %.10g | partial_fit + merge: %.10g\n", full->intercept, first->intercept);
+    printf("partial_fit + merge + finalize equals fit: %s\n", max_diff < 1e-9 ? "OK" : "MISMATCH");
+
+    // Cleanup
+    matrix_free(df);
+    linear_regression_free(full);
+    linear_regression_free(first);
+    linear_regression_free(second);
+}
@@ -0,0 +1,31 @@
+// Import the necessary packages
+#include <stdio.h>
+#include "../random/random.h"
+
+void test_random() {
+    // Two generators on the same seed and stream
+    pcg32_random_t stepped, advanced;
+    pcg32_seed_stream_r(&stepped, 42, 7);
+    pcg32_seed_stream_r(&advanced, 42, 7);
+
+    // Step one generator draw by draw and jump the other ahead, they must then produce the same draws
+    const uint64_t deltas[] = {1, 10, 1000, 123457};
+    for (int k = 0; k < 4; k++) {
+        for (uint64_t i = 0; i < deltas[k]; i++) {
+            pcg32_random_r(&stepped);
+        }
+        pcg32_advance_r(&advanced, deltas[k]);
+        const uint32_t a = pcg32_random_r(&stepped);
+        const uint32_t b = pcg32_random_r(&advanced);
+        printf("Advance by %-7llu | Stepped: %10u | Advanced: %10u | %s\n", (unsigned long long)deltas[k], a, b, a == b ? "OK" : "MISMATCH");
+    }
+
+    // pcg32_fill_double gives the same numbers as drawing them one at a time
+    double filled[8];
+    pcg32_fill_double(&advanced, filled, 8);
+    int same = 1;
+    for (int i = 0; i < 8; i++) {
+        if (filled[i] != pcg32_random_double_r(&stepped)) same = 0;
+    }
+    printf("pcg32_fill_double: %s\n", same ? "OK" : "MISMATCH");
+}
@@ -0,0 +1,215 @@
+#include "thread_pool.h"
+#include "../errors/errors.h"
+
+#include <stdlib.h>
+
+static ThreadPool *global_pool = NULL;
+static int global_num_threads = 1;
+
+static void *thread_pool_worker(void *arg) {
+    const ThreadPoolWorker *worker = arg;
+    ThreadPool *pool = worker->pool;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    while (1) {
+        while (!pool->shutdown && pool->generation == seen) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        if (pool->shutdown) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        seen = pool->generation;
+        const ThreadPoolTask func = pool->func;
+        void *ctx = pool->ctx;
+        const int num_tasks = pool->num_tasks;
+        pthread_mutex_unlock(&pool->lock);
+
+        int task;
+        while ((task = atomic_fetch_add(&pool->next_task, 1)) < num_tasks) {
+            func(ctx, task, worker->id);
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0) {
+            pthread_cond_signal(&pool->work_done);
+        }
+    }
+}
+
+ThreadPool *thread_pool_create(const int num_threads) {
+    if (num_threads < 1) {
+        CUSTOM_ERROR("'num_threads' must be at least 1");
+        return NULL;
+    }
+
+    ThreadPool *pool = malloc(sizeof(ThreadPool));
+    if (!pool) {
+        ALLOCATION_ERROR();
+        return NULL;
+    }
+    pool->threads = malloc(sizeof(pthread_t) * num_threads);
+    pool->workers = malloc(sizeof(ThreadPoolWorker) * num_threads);
+    if (!pool->threads || !pool->workers) {
+        ALLOCATION_ERROR();
+        free(pool->threads);
+        free(pool->workers);
+        free(pool);
+        return NULL;
+    }
+
+    pool->num_threads = 1;
+    pool->generation = 0;
+    pool->pending = 0;
+    pool->shutdown = 0;
+    pool->func = NULL;
+    pool->ctx = NULL;
+    pool->num_tasks = 0;
+    atomic_init(&pool->next_task, 0);
+    atomic_flag_clear(&pool->busy);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+
+    // Thread 0 is the caller of thread_pool_run, only the rest are spawned
+    for (int i = 1; i < num_threads; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].id = i;
+        if (pthread_create(&pool->threads[i], NULL, thread_pool_worker, &pool->workers[i]) != 0) {
+            CUSTOM_WARNING("Could only start %d of %d threads", i, num_threads);
+            break;
+        }
+        pool->num_threads++;
+    }
+
+    return pool;
+}
+
+void thread_pool_free(ThreadPool *pool) {
+    if (!pool) {
+        NULL_ERROR("ThreadPool");
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 1; i < pool->num_threads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->work_done);
+    free(pool->threads);
+    free(pool->workers);
+    free(pool);
+}
+
+void thread_pool_run(ThreadPool *pool, const int num_tasks, const ThreadPoolTask func, void *ctx) {
+    if (!func) {
+        CUSTOM_ERROR("Function pointer is NULL");
+        return;
+    }
+
+    // Nested or concurrent calls run on the calling thread instead of waiting for the pool
+    if (!pool || pool->num_threads == 1 || num_tasks < 2 || atomic_flag_test_and_set(&pool->busy)) {
+        for (int task = 0; task < num_tasks; task++) {
+            func(ctx, task, 0);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->func = func;
+    pool->ctx = ctx;
+    pool->num_tasks = num_tasks;
+    atomic_store(&pool->next_task, 0);
+    pool->pending = pool->num_threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    int task;
+    while ((task = atomic_fetch_add(&pool->next_task, 1)) < num_tasks) {
+        func(ctx, task, 0);
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0) {
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    atomic_flag_clear(&pool->busy);
+}
+
+void clearn_set_num_threads(const int num_threads) {
+    if (num_threads < 1) {
+        CUSTOM_ERROR("'num_threads' must be at least 1");
+        return;
+    }
+    if (num_threads == global_num_threads) {
+        return;
+    }
+
+    if (global_pool) {
+        thread_pool_free(global_pool);
+        global_pool = NULL;
+    }
+    global_num_threads = 1;
+
+    if (num_threads > 1) {
+        global_pool = thread_pool_create(num_threads);
+        if (global_pool) {
+            global_num_threads = global_pool->num_threads;
+        }
+    }
+}
+
+int clearn_get_num_threads(void) {
+    return global_num_threads;
+}
+
+ThreadPool *clearn_thread_pool(void) {
+    return global_pool;
+}
+
+typedef struct {
+    ThreadPoolRange func;
+    void *ctx;
+    int n;
+    int chunk;
+} ParallelForTask;
+
+static void parallel_for_task(void *ctx, const int task, const int thread) {
+    const ParallelForTask *pf = ctx;
+    const int start = task * pf->chunk;
+    const int end = start + pf->chunk > pf->n ? pf->n : start + pf->chunk;
+    pf->func(pf->ctx, start, end);
+}
+
+void clearn_parallel_for(const int n, const int grain, const ThreadPoolRange func, void *ctx) {
+    if (!func) {
+        CUSTOM_ERROR("Function pointer is NULL");
+        return;
+    }
+    if (n < 1) {
+        return;
+    }
+
+    if (!global_pool || grain < 1 || n < 2 * grain) {
+        func(ctx, 0, n);
+        return;
+    }
+
+    int num_chunks = n / grain;
+    if (num_chunks > 4 * global_num_threads) {
+        num_chunks = 4 * global_num_threads;
+    }
+    ParallelForTask pf = {func, ctx, n, (n + num_chunks - 1) / num_chunks};
+    thread_pool_run(global_pool, (n + pf.chunk - 1) / pf.chunk, parallel_for_task, &pf);
+}
@@ -0,0 +1,43 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+typedef void (*ThreadPoolTask)(void *ctx, int task, int thread);
+typedef void (*ThreadPoolRange)(void *ctx, int start, int end);
+
+typedef struct ThreadPool ThreadPool;
+
+typedef struct {
+    ThreadPool *pool;
+    int id;
+} ThreadPoolWorker;
+
+struct ThreadPool {
+    int num_threads;
+    pthread_t *threads;
+    ThreadPoolWorker *workers;
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    unsigned long generation;
+    int pending;
+    int shutdown;
+    ThreadPoolTask func;
+    void *ctx;
+    int num_tasks;
+    atomic_int next_task;
+    atomic_flag busy;
+};
+
+ThreadPool *thread_pool_create(int num_threads);
+void thread_pool_free(ThreadPool *pool);
+void thread_pool_run(ThreadPool *pool, int num_tasks, ThreadPoolTask func, void *ctx);
+
+void clearn_set_num_threads(int num_threads);
+int clearn_get_num_threads(void);
+ThreadPool *clearn_thread_pool(void);
+void clearn_parallel_for(int n, int grain, ThreadPoolRange func, void *ctx);
+
+#endif
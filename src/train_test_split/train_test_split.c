@@ -1,8 +1,16 @@
 ﻿#include "train_test_split.h"
 
+#include <string.h>
 #include <time.h>
 
 void train_test_split(const Matrix *X, const Vector *y, Matrix **X_train, Matrix **X_test, Vector **y_train, Vector **y_test, const double test_size, const int random_state) {
+    const uint64_t seed = random_state < 0 ? (uint64_t)time(NULL) : (uint64_t)random_state;
+    pcg32_random_t rng;
+    pcg32_seed_r(&rng, seed);
+    train_test_split_r(X, y, X_train, X_test, y_train, y_test, test_size, &rng);
+}
+
+void train_test_split_r(const Matrix *X, const Vector *y, Matrix **X_train, Matrix **X_test, Vector **y_train, Vector **y_test, const double test_size, pcg32_random_t *rng) {
     if (!X || !X_train || !X_test) {
         NULL_ERROR("Matrix");
         return;
@@ -24,8 +32,10 @@ void train_test_split(const Matrix *X, const Vector *y, Matrix **X_train, Matrix
         return;
     }
 
-    const uint64_t seed = random_state < 0 ? (uint64_t)time(NULL) : (uint64_t)random_state;
-    pcg32_seed(seed);
+    if (!rng) {
+        NULL_ERROR("Random generator");
+        return;
+    }
 
     Vector *indices = vector_create(X->rows);
     if (!indices) {
@@ -33,9 +43,9 @@ void train_test_split(const Matrix *X, const Vector *y, Matrix **X_train, Matrix
         return;
     }
     for (int i = 0; i < indices->dim; i++) {
-        vector_set(indices, i, i);
+        indices->data[i] = i;
     }
-    vector_shuffle(indices);
+    vector_shuffle_r(indices, rng);
 
     const int te_size = (int)(X->rows * test_size);
     const int tr_size = X->rows - te_size;
@@ -54,21 +64,17 @@ void train_test_split(const Matrix *X, const Vector *y, Matrix **X_train, Matrix
         return;
     }
 
-    int train_idx = 0, test_idx = 0;
+    const size_t row_bytes = sizeof(double) * X->cols;
     for (int i = 0; i < X->rows; i++) {
-        const int in = (int)vector_get(indices, i);
+        const int in = (int)indices->data[i];
+        const double *src = X->data + (size_t)in * X->cols;
         if (i < tr_size) {
-            for (int j = 0; j < X->cols; j++) {
-                matrix_set(X_train_set, train_idx, j, matrix_get(X, in, j));
-            }
-            vector_set(y_train_set, train_idx, vector_get(y, in));
-            train_idx++;
+            memcpy(X_train_set->data + (size_t)i * X->cols, src, row_bytes);
+            y_train_set->data[i] = y->data[in];
         } else {
-            for (int j = 0; j < X->cols; j++) {
-                matrix_set(X_test_set, test_idx, j, matrix_get(X, in, j));
-            }
-            vector_set(y_test_set, test_idx, vector_get(y, in));
-            test_idx++;
+            const int test_idx = i - tr_size;
+            memcpy(X_test_set->data + (size_t)test_idx * X->cols, src, row_bytes);
+            y_test_set->data[test_idx] = y->data[in];
         }
     }
 
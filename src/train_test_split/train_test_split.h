@@ -4,5 +4,7 @@
 #include "../matrix/matrix.h"
 
 void train_test_split(const Matrix *X, const Vector *y, Matrix **X_train, Matrix **X_test, Vector **y_train, Vector **y_test, double test_size, int random_state);
+// Same split with the rows shuffled by rng, which advances, instead of a generator seeded with random_state
+void train_test_split_r(const Matrix *X, const Vector *y, Matrix **X_train, Matrix **X_test, Vector **y_train, Vector **y_test, double test_size, pcg32_random_t *rng);
 
 #endif
\ No newline at end of file
@@ -37,11 +37,36 @@ Vector *vector_copy(const Vector *x) {
         ALLOCATION_ERROR();
         return NULL;
     }
-    memcpy(copy->data, x->data, sizeof(double) * x->dim);
+    vector_copy_into(copy, x);
 
     return copy;
 }
 
+static int vector_check_destination(const Vector *dst, const int dim) {
+    if (!dst) {
+        NULL_ERROR("Destination vector");
+        return 0;
+    }
+    if (dst->dim != dim) {
+        CUSTOM_ERROR("Destination vector must have dimension %d, got %d", dim, dst->dim);
+        return 0;
+    }
+    return 1;
+}
+
+void vector_copy_into(Vector *dst, const Vector *x) {
+    if (!x) {
+        NULL_ERROR("Vector");
+        return;
+    }
+    if (!vector_check_destination(dst, x->dim)) {
+        return;
+    }
+    if (dst->data != x->data) {
+        memcpy(dst->data, x->data, sizeof(double) * x->dim);
+    }
+}
+
 void vector_free(Vector *x) {
     if (x) {
         free(x->data);
@@ -51,6 +76,7 @@ void vector_free(Vector *x) {
     }
 }
 
+#ifdef CLEARN_CHECKED_ACCESS
 double vector_get(const Vector *x, const int i) {
     if (!x) {
         NULL_ERROR("Vector");
@@ -74,6 +100,44 @@ void vector_set(Vector *x, const int i, const double value) {
     }
     x->data[i] = value;
 }
+#endif
+
+VectorView vector_view(const Vector *x) {
+    if (!x) {
+        NULL_ERROR("Vector");
+        return (VectorView){NULL, 0, 0};
+    }
+    return (VectorView){x->data, x->dim, 1};
+}
+
+VectorView vector_view_slice(const Vector *x, const int start, const int end) {
+    if (!x) {
+        NULL_ERROR("Vector");
+        return (VectorView){NULL, 0, 0};
+    }
+    if (start < 0 || end > x->dim || start >= end) {
+        INDEX_ERROR();
+        return (VectorView){NULL, 0, 0};
+    }
+    return (VectorView){x->data + start, end - start, 1};
+}
+
+Vector *vector_view_copy(const VectorView x) {
+    if (!x.data) {
+        NULL_ERROR("VectorView");
+        return NULL;
+    }
+
+    Vector *copy = vector_create(x.dim);
+    if (!copy) {
+        ALLOCATION_ERROR();
+        return NULL;
+    }
+    for (int i = 0; i < x.dim; i++) {
+        copy->data[i] = x.data[(size_t)i * x.stride];
+    }
+    return copy;
+}
 
 void vector_print(const Vector *x) {
     if (!x) {
@@ -155,11 +219,35 @@ Vector *vector_arithmetic(const Vector *x, const Vector *y, const char op) {
         return NULL;
     }
 
+    if (op != '+' && op != '-' && op != '*' && op != '/') {
+        CUSTOM_ERROR("Invalid operator");
+        return NULL;
+    }
+
     Vector *z = vector_create(x->dim);
     if (!z) {
         ALLOCATION_ERROR();
         return NULL;
     }
+    vector_arithmetic_into(z, x, y, op);
+
+    return z;
+}
+
+void vector_arithmetic_into(Vector *z, const Vector *x, const Vector *y, const char op) {
+    if (!x || !y) {
+        NULL_ERROR("Vector");
+        return;
+    }
+
+    if (x->dim != y->dim) {
+        CUSTOM_ERROR("Vector dimensions must match");
+        return;
+    }
+
+    if (!vector_check_destination(z, x->dim)) {
+        return;
+    }
 
     switch (op) {
         case '+':
@@ -190,11 +278,8 @@ Vector *vector_arithmetic(const Vector *x, const Vector *y, const char op) {
 
         default:
             CUSTOM_ERROR("Invalid operator");
-            vector_free(z);
-            return NULL;
+            return;
     }
-
-    return z;
 }
 
 void vector_scalar_arithmetic(Vector *x, const double scalar, const char op) {
@@ -342,12 +427,20 @@ void vector_apply(Vector *x, double (*func)(double)) {
 }
 
 void vector_shuffle(Vector *x) {
+    vector_shuffle_r(x, &pcg_state);
+}
+
+void vector_shuffle_r(Vector *x, pcg32_random_t *rng) {
     if (!x) {
         NULL_ERROR("Vector");
         return;
     }
+    if (!rng) {
+        NULL_ERROR("Random generator");
+        return;
+    }
     for (int i = x->dim - 1; i > 0; i--) {
-        const int j = (int)(pcg32_random_double() * (i + 1));
+        const int j = (int)(pcg32_random_double_r(rng) * (i + 1));
         const double temp = x->data[i];
         x->data[i] = x->data[j];
         x->data[j] = temp;
@@ -1,6 +1,8 @@
 ﻿#ifndef VECTOR_H
 #define VECTOR_H
 
+#include <stddef.h>
+
 #include "../errors/errors.h"
 #include "../random/random.h"
 
@@ -11,16 +13,45 @@ typedef struct {
 
 Vector *vector_create(int dim);
 Vector *vector_copy(const Vector *x);
+void vector_copy_into(Vector *dst, const Vector *x);
 void vector_free(Vector *x);
 
+// Bounds-checked with CLEARN_CHECKED_ACCESS, see matrix_get
+#ifdef CLEARN_CHECKED_ACCESS
 double vector_get(const Vector *x, int i);
 void vector_set(Vector *x, int i, double value);
+#else
+static inline double vector_get(const Vector *x, const int i) {
+    return x->data[i];
+}
+
+static inline void vector_set(Vector *x, const int i, const double value) {
+    x->data[i] = value;
+}
+#endif
+
+// Non-owning strided window into vector or matrix data: element i is data[i * stride]. Made in O(1) without
+// copying and valid only while the data it looks into is alive
+typedef struct {
+    double *data;
+    int dim;
+    size_t stride;
+} VectorView;
+
+static inline double vector_view_get(const VectorView x, const int i) {
+    return x.data[(size_t)i * x.stride];
+}
+
+VectorView vector_view(const Vector *x);
+VectorView vector_view_slice(const Vector *x, int start, int end);
+Vector *vector_view_copy(VectorView x);
 
 void vector_print(const Vector *x);
 void vector_print_head(const Vector *x, int num);
 void vector_print_tail(const Vector *x, int num);
 
 Vector *vector_arithmetic(const Vector *x, const Vector *y, char op);
+void vector_arithmetic_into(Vector *z, const Vector *x, const Vector *y, char op);
 void vector_scalar_arithmetic(Vector *x, double scalar, char op);
 
 double vector_min(const Vector *x);
@@ -33,5 +64,7 @@ double vector_dot_product(const Vector *x, const Vector *y);
 void vector_apply(Vector *x, double (*func)(double));
 
 void vector_shuffle(Vector *x);
+// Shuffles with the given generator instead of the global one
+void vector_shuffle_r(Vector *x, pcg32_random_t *rng);
 
 #endif
\ No newline at end of file